@@ -1,4 +1,4 @@
-#include "../src/optimizer/optimizer.h"
+#include "../src/optimizer/island.h"
 
 using namespace op;
 using namespace path;
@@ -18,6 +18,27 @@ int main(int argc, char *argv[])
   }
 
   executionConfig eConf(path);
+  limitEigenThreads(eConf);
+  if(eConf.islands > 1){
+    auto create = [](executionConfig conf){
+      return make_shared<op::Optimizer>(
+		     make_shared<op::InitStrategy>(op::InitStrategy()),
+		     make_shared<op::SelectionStrategy>(op::SelectionStrategy()),
+		     make_shared<op::DualPointCrossover>(op::DualPointCrossover()),
+		     make_shared<op::MutationStrategy>(op::MutationStrategy()),
+		     make_shared<op::FitnessStrategy>(op::FitnessStrategy()),
+		     conf);
+    };
+    unique_ptr<op::IslandModel> model;
+    if(eConf.islandProcesses)
+      model = make_unique<op::ProcessIslands>(eConf, create);
+    else
+      model = make_unique<op::IslandModel>(eConf, create);
+    // Runs the retrain phase as well
+    model->run(eConf.printInfo);
+    return 0;
+  }
+
   op::Optimizer opti(
 		     make_shared<op::InitStrategy>(op::InitStrategy()),
 		     make_shared<op::SelectionStrategy>(op::SelectionStrategy()),
@@ -25,20 +46,14 @@ int main(int argc, char *argv[])
 		     make_shared<op::MutationStrategy>(op::MutationStrategy()),
 		     make_shared<op::FitnessStrategy>(op::FitnessStrategy()),
 		     eConf);
-  if(eConf.scenario == 0)  // elitist selection
-    opti.optimizePath(eConf.printInfo);
-  else
-    opti.optimizePath_Turn_RWS(eConf.printInfo);
+  opti.optimize(eConf.printInfo);
 
 
 
   if(eConf.retrain){
     mapgen::emulateCoveredMapSegment(opti.eConf.gmap, eConf.start);
     opti.eConf.maxIterations = eConf.retrain;
-    if(eConf.scenario == 0)  // elitist selection
-      opti.optimizePath(eConf.printInfo);
-    else
-      opti.optimizePath_Turn_RWS(eConf.printInfo);
+    opti.optimize(eConf.printInfo);
 
   }
 
@@ -4,18 +4,20 @@
 /////////////////////////////////////////////////////////////////////////////
 //                            CrossoverStrategy                             //
 /////////////////////////////////////////////////////////////////////////////
-void cross::DualPointCrossover::operator()(SelectionPool& selPool, Genpool& nextPool , executionConfig& eConf){
+void cross::DualPointCrossover::operator()(SelectionPool& selPool, Genpool& nextPool , executionConfig& eConf, const Genpool *carried){
   assert(selPool.size() > 0);
   eConf.crossFailed = 0;
+  // Each pair adds at most two parents, children get new ids and need no registration
+  PoolMembers members(nextPool, nextPool.size() + 2 * selPool.size() + (carried ? carried->size() : 0));
+  if(carried)
+    members.track(*carried);
+  int pair = 0;
   for (auto it = selPool.begin(); it != selPool.end(); ++it) {
+    eConf.stream(rng::Op::Crossover, pair++);
     if(!applyAction(eConf.crossoverProba, eConf) or !mating(it->first, it->second, nextPool, eConf)){
       // Add gens to pool if they are not already inside
-      if(std::find(nextPool.begin(), nextPool.end(), it->first)
-	 != nextPool.end())
-	nextPool.push_back(it->first);
-      if(std::find(nextPool.begin(), nextPool.end(), it->second)
-	 != nextPool.end())
-	nextPool.push_back(it->second);
+      members.insert(it->first);
+      members.insert(it->second);
       eConf.crossFailed++;
       continue;
     }
@@ -27,10 +29,11 @@ void cross::DualPointCrossover::operator()(SelectionPool& selPool, Genpool& next
 
 void cross::DualPointCrossover::operator()(FamilyPool& fPool, Genpool& pool , executionConfig& eConf){
   assert(fPool.size() > 0);
-  for (auto &family : fPool) {
-    assert(family.size() == 2);
+  for (int f=0; f<fPool.size(); f++) {
+    auto &family = fPool[f];
     // Check if crossover can be performed
-    if(!applyAction(eConf.crossoverProba, eConf) or !mating(family[0], family[1], family, eConf)){
+    eConf.stream(rng::Op::Crossover, f);
+    if(!mateFamily(family, eConf)){
       // Add gens to pool if they are not already inside
       pool.push_back(family[0]);
       pool.push_back(family[1]);
@@ -41,64 +44,119 @@ void cross::DualPointCrossover::operator()(FamilyPool& fPool, Genpool& pool , ex
     // mating(family[0], family[1], family, eConf);
     // assert(family.size() >= 4);
   }
-  if(pool.size() > 0)
-    sort(pool.begin(), pool.end());
-
 }
 
+bool cross::DualPointCrossover::mateFamily(Genpool &family, executionConfig& eConf){
+  assert(family.size() == 2);
+  return applyAction(eConf.crossoverProba, eConf) and mating(family[0], family[1], family, eConf);
+}
 
-void cross::CrossoverStrategy::copyActions(PAs::iterator begin, PAs::iterator end, PAs &child, bool modify){
+void cross::CrossoverStrategy::copyActions(PAs::const_iterator begin, PAs::const_iterator end, PAs &child, bool modify){
   for(begin; begin != end; begin++){
     // debug("Type: ", (int) (*begin)->type);
     assert((*begin)->wps.size() > 0);
     switch((*begin)->type){
     case PAT::Start:{
       StartAction sa((*begin)->wps.front());
-      child.push_back(make_shared<StartAction>(sa));
+      sa.cp = (*begin)->cp;
+      child.push_back(newAction<StartAction>(sa));
       break;
     }
     case PAT::Ahead: case PAT::CAhead:{
       AheadAction aa((*begin)->type, (*begin)->mod_config);
-      aa.generateWPs((*begin)->wps.front());
+      if(modify){
+	aa.generateWPs((*begin)->wps.front());
+      }else{
+	// Keep the exact geometry such that the recorded coverage stays valid
+	aa.wps = (*begin)->wps;
+	aa.cp = (*begin)->cp;
+      }
       aa.modified = modify;
-      child.push_back(make_shared<AheadAction>(aa));
+      child.push_back(newAction<AheadAction>(aa));
       break;
     }
     case PAT::End:
-      child.push_back(make_shared<EndAction>(EndAction((*begin)->wps)));
+      child.push_back(newAction<EndAction>(EndAction((*begin)->get_wps())));
     }
   }
 }
 
-genome cross::DualPointCrossover::getChild(PAs par1, PAs par2, int sIdx[2], int len[2], bool move){
-  PAs child;
+void cross::CrossoverStrategy::shareActions(PAs::const_iterator begin, PAs::const_iterator end, PAs &child){
+  for(begin; begin != end; begin++){
+    assert((*begin)->wps.size() > 0);
+    if(!(*begin)->modified){
+      child.push_back(*begin);
+      continue;
+    }
+    // Pending changes of the parent must not be applied to the child
+    child.push_back((*begin)->clone());
+    child.back()->modified = false;
+  }
+}
 
-  copyActions(par1.begin(),
-	      next(par1.begin(), sIdx[0]),
-	      child);
+genome cross::DualPointCrossover::getChild(const PAs &par1, const PAs &par2, int sIdx[2], int len[2], bool move){
+  return getChildren(par1, par2, sIdx, len, move ? 0 : 1).front();
+}
+
+vector<genome> cross::DualPointCrossover::getChildren(const PAs &par1, const PAs &par2, int sIdx[2], int len[2], int selector){
+  assertm(selector >= 0 && selector <= 2, "Wrong value for child selector");
+  bool local = selector != 1;
+  bool global = selector != 0;
+  auto midBegin = next(par2.begin(), sIdx[1]);
+  auto midEnd = next(par2.begin(), (sIdx[1]+len[1]));
+
+  // Prefix and suffix are the same for both variants
+  PAs shared;
+  shareActions(par1.begin(),
+	       next(par1.begin(), sIdx[0]),
+	       shared);
   // Insert cross over part from parent 2
-  // Mark the inserted part as modified to recalculate waypoints
-  copyActions(next(par2.begin(), sIdx[1]),
-	      next(par2.begin(), (sIdx[1]+len[1])),
-	      child, move); // if move is true we loose locality
+  shareActions(midBegin, midEnd, shared);
   // Append remaining part
-  copyActions(next(par1.begin(), sIdx[0] + len[0]),
-	      par1.end(),
-	      child);
-
+  shareActions(next(par1.begin(), sIdx[0] + len[0]),
+	       par1.end(),
+	       shared);
   // Check if copy was successful
-  assert(child.size() == (par1.size() - len[0] + len[1]));
+  assert(shared.size() == (par1.size() - len[0] + len[1]));
+
+  vector<genome> children;
+  if(local){
+    // Moved actions are recreated to recalculate their waypoints
+    PAs moved;
+    copyActions(midBegin, midEnd, moved, true); // we loose locality
+    PAs child = global ? shared : std::move(shared);
+    std::move(moved.begin(), moved.end(), next(child.begin(), sIdx[0]));
+    children.push_back(finishChild(std::move(child), sIdx[0], len[1]));
+  }
+  if(global)
+    children.push_back(finishChild(std::move(shared), sIdx[0], len[1]));
+  return children;
+}
 
-  // Mark actions as
-  (*next(child.begin(), sIdx[0] - 1))->modified = true;
-  (*next(child.begin(), sIdx[0] + len[1] - 1))->modified = true;
-  genome child_gen(child);
+genome cross::DualPointCrossover::finishChild(PAs child, int sIdx, int len){
+  genome child_gen(std::move(child));
+  // Mark actions as modified, the parents keep their version
+  auto first = next(child_gen.actions.begin(), sIdx - 1);
+  auto last = next(child_gen.actions.begin(), sIdx + len - 1);
+  child_gen.detach(first);
+  child_gen.detach(last);
+  (*first)->modified = true;
+  (*last)->modified = true;
   validateGen(child_gen);
   assert(child_gen.actions.front()->type == PAT::Start
 	 && child_gen.actions.back()->type == PAT::End);
   return child_gen;
 }
 
+void cross::DualPointCrossover::insertChildren(vector<genome> &first, vector<genome> &second, Genpool &newPopulation){
+  assert(first.size() == second.size());
+  // Local children are inserted before the global ones
+  for(int i=0; i<first.size(); i++){
+    newPopulation.push_back(std::move(first[i]));
+    newPopulation.push_back(std::move(second[i]));
+  }
+}
+
 bool cross::DualPointCrossover::mating(genome &par1, genome &par2, Genpool& newPopulation, executionConfig& eConf){
   // mate two parents
   // estimate the individual Length
@@ -132,38 +190,17 @@ bool cross::DualPointCrossover::mating(genome &par1, genome &par2, Genpool& newP
   assert(sIdx[0] + len1 < par1.actions.size());
   assert(sIdx[1] + len2 < par2.actions.size());
 
-  vector<genome> loc, glob;
-
   // Calculate children for first parent
-  loc.push_back(getChild(par1.actions, par2.actions, sIdx, len, true));
-  glob.push_back(getChild(par1.actions, par2.actions, sIdx, len, false));
+  auto first = getChildren(par1.actions, par2.actions, sIdx, len, eConf.crossChildSelector);
   sIdx[0] = sIdx2;
   sIdx[1] = sIdx1;
   len[0] = len2;
   len[1] = len1;
   // Calculate children for second parent
-  loc.push_back(getChild(par2.actions, par1.actions, sIdx, len, true));
-  glob.push_back(getChild(par2.actions, par1.actions, sIdx, len, false));
+  auto second = getChildren(par2.actions, par1.actions, sIdx, len, eConf.crossChildSelector);
 
   // Insert to new Population
-  switch(eConf.crossChildSelector){
-  case 0:{
-    newPopulation.insert(newPopulation.end(), loc.begin(), loc.end());
-    break;
-  }
-  case 1:{
-    newPopulation.insert(newPopulation.end(), glob.begin(), glob.end());
-    break;
-  }
-  case 2:{
-    newPopulation.insert(newPopulation.end(), loc.begin(), loc.end());
-    newPopulation.insert(newPopulation.end(), glob.begin(), glob.end());
-    break;
-  }
-  default:{
-    assertm(false, "Wrong value for child selector");
-  }
-  }
+  insertChildren(first, second, newPopulation);
   return true;
 }
 
@@ -219,37 +256,16 @@ bool cross::SameStartDualPointCrossover::mating(genome &par1, genome &par2, Genp
   assert(sIdx[0] + len1 < par1.actions.size());
   assert(sIdx[1] + len2 < par2.actions.size());
 
-  vector<genome> loc, glob;
-
   // Calculate children for first parent
-  loc.push_back(getChild(par1.actions, par2.actions, sIdx, len, true));
-  glob.push_back(getChild(par1.actions, par2.actions, sIdx, len, false));
+  auto first = getChildren(par1.actions, par2.actions, sIdx, len, eConf.crossChildSelector);
   // sIdx[0] = sIdx2;
   // sIdx[1] = sIdx1;
   len[0] = len2;
   len[1] = len1;
   // Calculate children for second parent
-  loc.push_back(getChild(par2.actions, par1.actions, sIdx, len, true));
-  glob.push_back(getChild(par2.actions, par1.actions, sIdx, len, false));
+  auto second = getChildren(par2.actions, par1.actions, sIdx, len, eConf.crossChildSelector);
 
   // Insert to new Population
-  switch(eConf.crossChildSelector){
-  case 0:{
-    newPopulation.insert(newPopulation.end(), loc.begin(), loc.end());
-    break;
-  }
-  case 1:{
-    newPopulation.insert(newPopulation.end(), glob.begin(), glob.end());
-    break;
-  }
-  case 2:{
-    newPopulation.insert(newPopulation.end(), loc.begin(), loc.end());
-    newPopulation.insert(newPopulation.end(), glob.begin(), glob.end());
-    break;
-  }
-  default:{
-    assertm(false, "Wrong value for child selector");
-  }
-  }
+  insertChildren(first, second, newPopulation);
   return true;
 }
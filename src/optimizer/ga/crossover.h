@@ -45,16 +45,43 @@ namespace cross {
     // Conditions:
     // - Selection pools needs to be filled
     // - Next Pool is expected to be already emptied
-    virtual void operator()(SelectionPool& selPool, Genpool& nextPool , executionConfig& eConf) = 0;
+    // Parents of failed pairs are passed on once, unless they are part of nextPool or carried
+    // (gens that enter the next generation by other means, e.g. the elites)
+    virtual void operator()(SelectionPool& selPool, Genpool& nextPool , executionConfig& eConf, const Genpool *carried = nullptr) = 0;
     virtual void operator()(FamilyPool& fPool, Genpool& pool , executionConfig& eConf) = 0;
-    void copyActions(PAs::iterator begin, PAs::iterator end, PAs &child, bool modify=false);
+    // Append new actions with the parameter of [begin, end) to child
+    void copyActions(PAs::const_iterator begin, PAs::const_iterator end, PAs &child, bool modify=false);
+    /**
+     * @brief      Append the actions [begin, end) to child without copying.
+     *
+     * @details    Child and parent share the actions, they are copied once
+     *             one of the gens changes them (see genome::detach).
+     */
+    void shareActions(PAs::const_iterator begin, PAs::const_iterator end, PAs &child);
   };
 
   struct DualPointCrossover : CrossoverStrategy {
-    virtual void operator()(SelectionPool& selPool, Genpool& nextPool , executionConfig& eConf) override;
+    virtual void operator()(SelectionPool& selPool, Genpool& nextPool , executionConfig& eConf, const Genpool *carried = nullptr) override;
     virtual void operator()(FamilyPool& fPool, Genpool& pool , executionConfig& eConf) override;
     virtual bool mating(genome &par1, genome &par2, Genpool& newPopulation, executionConfig& eConf);
-    virtual genome getChild(PAs par1, PAs par2, int sIdx[2], int len[2], bool move);
+    // Append the children of family[0] and family[1] to the family, false if the crossover was not applied
+    bool mateFamily(Genpool &family, executionConfig& eConf);
+    virtual genome getChild(const PAs &par1, const PAs &par2, int sIdx[2], int len[2], bool move);
+    /**
+     * @brief      Create the children of par1 selected by crossChildSelector.
+     *
+     * @details    Replaces [sIdx[0], sIdx[0]+len[0]) of par1 by
+     *             [sIdx[1], sIdx[1]+len[1]) of par2. Selector 0 creates the
+     *             local child (moved part is recalculated), 1 the global
+     *             child and 2 both (local first). Only the requested
+     *             children are validated, prefix and suffix are assembled
+     *             once for both.
+     */
+    vector<genome> getChildren(const PAs &par1, const PAs &par2, int sIdx[2], int len[2], int selector);
+    // Mark the crossing points as modified and validate the child
+    genome finishChild(PAs child, int sIdx, int len);
+    // Insert the children of both parents in the order of the old child pools
+    void insertChildren(vector<genome> &first, vector<genome> &second, Genpool &newPopulation);
   };
 
   struct SameStartDualPointCrossover : DualPointCrossover {
@@ -120,38 +120,214 @@ void fit::FitnessStrategy::operator()(Genpool &currentPool, path::Robot &rob, ex
 }
 
 
+void fit::FitnessStrategy::operator()(Genpool &currentPool, path::RobotPool &robots, executionConfig& eConf){
+  resetLoggingFitnessParameter(eConf);
+  assert(currentPool.size() > 0);
+  vector<genome*> gens;
+  for(auto &gen : currentPool)
+    gens.push_back(&gen);
+  estimateGens(gens, robots, eConf);
+  applyPoolBias(currentPool, eConf);
+  finalizeFitnessLogging(currentPool.size(), eConf);
+}
+
+
 void fit::FitnessStrategy::operator()(FamilyPool& fPool, path::Robot &rob, executionConfig& eConf) {
   // Deactivate logging -> recalculate with
   // resetLoggingFitnessParameter(eConf);
   for (auto &family : fPool) {
-    if(family.size() > 2){
-      for (int i = 2; i < family.size(); i++) {
-        assertm(family[i].actions.size() > 0, "Not enough actions");
-	// removeZeroPAs(family[i], eConf.mapResolution);
-        bool eva = rob.evaluateActions(family[i].actions);
-	assert(eva);
-        // assertm(family[i].actions.size() > 0, "Not enough actions");
-        calculation(family[i], rob.getFreeArea(), eConf);
-        // trackFitnessParameter(family[i] , eConf);
-      }
-      applyPoolBias(family, eConf, true);
+    evaluateFamily(family, rob, eConf);
+  }
+}
+
+void fit::FitnessStrategy::evaluateFamily(Genpool &family, path::Robot &rob, executionConfig& eConf, mutex *cacheMtx){
+  if(family.size() <= 2)
+    return;
+  auto cacheLock = [cacheMtx](){
+    return cacheMtx ? unique_lock<mutex>(*cacheMtx) : unique_lock<mutex>();
+  };
+  for (int i = 2; i < family.size(); i++) {
+    assertm(family[i].actions.size() > 0, "Not enough actions");
+    {
+      auto lock = cacheLock();
+      if(restoreGen(family[i], eConf))
+	continue;
     }
+    // removeZeroPAs(family[i], eConf.mapResolution);
+    bool eva = rob.evaluateActions(family[i].actions);
+    assert(eva);
+    calculation(family[i], rob.getFreeArea(), eConf);
+    if(family[i].pathLengh > 0)
+      family[i].setPathSignature(rob, eConf.keepPathMatrix, eConf.diversitySketch);
+    auto lock = cacheLock();
+    storeGen(family[i], eConf);
+    // trackFitnessParameter(family[i] , eConf);
   }
+  applyPoolBias(family, eConf, true);
 }
 
 
 void fit::FitnessStrategy::estimateGen(genome &gen, path::Robot &rob, executionConfig& eConf){
+  if(!restoreGen(gen, eConf)){
+    evaluateGen(gen, rob, eConf);
+    storeGen(gen, eConf);
+  }
+  trackFitnessParameter(gen , eConf);
+}
+
+void fit::FitnessStrategy::evaluateGen(genome &gen, path::Robot &rob, executionConfig& eConf){
   assertm(gen.actions.size() > 0, "Not enough actions");
   if(rob.evaluateActions(gen.actions)){
     assertm(gen.actions.size() > 0, "Not enough actions");
     calculation(gen, rob.getFreeArea(), eConf);
-    trackFitnessParameter(gen , eConf);
+    // Set calculated path --> Diversity estimation
+    // Dead gens (path length 0) keep their old signature
+    if(gen.pathLengh > 0)
+      gen.setPathSignature(rob, eConf.keepPathMatrix, eConf.diversitySketch);
   }else{
     warn("Erase Gen!");
     assertm(false, "Attempt to erase a gen!!");
   }
 }
 
+void fit::FitnessStrategy::estimateGens(vector<genome*> &gens, path::RobotPool &robots, executionConfig& eConf, bool keepTrail){
+  // The trail is not cached, those gens need to be executed
+  vector<genome*> pending;
+  for(auto gen : gens)
+    if(keepTrail or !restoreGen(*gen, eConf))
+      pending.push_back(gen);
+
+  robots.run(pending.size(), [&](int i, path::Robot &rob){
+    evaluateGen(*pending[i], rob, eConf);
+    if(keepTrail){
+      rob.syncCoverage();
+      pending[i]->trail = 1 * (*rob.pmap)[rob.opName];
+    }
+  });
+  for(auto gen : pending)
+    storeGen(*gen, eConf);
+  for(auto gen : gens)
+    trackFitnessParameter(*gen, eConf);
+}
+
+bool fit::FitnessStrategy::restoreGen(genome &gen, executionConfig& eConf){
+  if(eConf.fitnessCacheSize <= 0)
+    return false;
+  for(auto &pa : gen.actions){
+    if(pa->modified or pa->wps.empty()){
+      eConf.cacheMisses++;
+      return false;
+    }
+  }
+  if(cache.lookup(gen, gen.structuralHash())){
+    eConf.cacheHits++;
+    return true;
+  }
+  eConf.cacheMisses++;
+  return false;
+}
+
+void fit::FitnessStrategy::storeGen(genome &gen, executionConfig& eConf){
+  if(eConf.fitnessCacheSize <= 0)
+    return;
+  cache.insert(gen, gen.structuralHash(), eConf.fitnessCacheSize);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                FitnessCache                               //
+///////////////////////////////////////////////////////////////////////////////
+
+fit::FitnessCache::Entry::Entry(const genome &gen)
+  :actions(gen.actions.size()),
+   checksum(check(gen)),
+   fitness(gen.fitness),
+   traveledDist(gen.traveledDist),
+   cross(gen.cross),
+   p_obj(gen.p_obj),
+   rotationCost(gen.rotationCost),
+   coverage(gen.coverage),
+   covered(gen.covered),
+   pixelCrossCoverage(gen.pixelCrossCoverage),
+   pathLengh(gen.pathLengh),
+   rotations(gen.rotations),
+   reachEnd(gen.reachEnd),
+   finalCoverage(gen.finalCoverage),
+   finalTime(gen.finalTime),
+   finalRotationTime(gen.finalRotationTime),
+   signature(gen.signature),
+   mat(gen.mat){}
+
+void fit::FitnessCache::Entry::apply(genome &gen) const{
+  gen.fitness = fitness;
+  gen.traveledDist = traveledDist;
+  gen.cross = cross;
+  gen.p_obj = p_obj;
+  gen.rotationCost = rotationCost;
+  gen.coverage = coverage;
+  gen.covered = covered;
+  gen.pixelCrossCoverage = pixelCrossCoverage;
+  gen.pathLengh = pathLengh;
+  gen.rotations = rotations;
+  gen.reachEnd = reachEnd;
+  gen.finalCoverage = finalCoverage;
+  gen.finalTime = finalTime;
+  gen.finalRotationTime = finalRotationTime;
+  // Dead gens keep their old signature
+  if(signature){
+    gen.signature = signature;
+    gen.mat = mat;
+  }
+}
+
+bool fit::FitnessCache::Entry::matches(const genome &gen) const{
+  return gen.actions.size() == actions and check(gen) == checksum;
+}
+
+size_t fit::FitnessCache::Entry::check(const genome &gen){
+  // FNV-1a over the bytes of the waypoints
+  size_t h = 0xcbf29ce484222325ULL;
+  auto mix = [&h](const void *data, size_t bytes){
+    auto *b = static_cast<const unsigned char*>(data);
+    for(size_t i=0; i<bytes; i++){
+      h ^= b[i];
+      h *= 0x100000001b3ULL;
+    }
+  };
+  for(auto &pa : gen.actions)
+    for(auto &wp : pa->wps)
+      mix(wp.data(), 2 * sizeof(wp[0]));
+  return h;
+}
+
+bool fit::FitnessCache::lookup(genome &gen, size_t key){
+  auto it = index.find(key);
+  if(it == index.end() or !it->second->second.matches(gen))
+    return false;
+  // Mark as most recently used
+  entries.splice(entries.begin(), entries, it->second);
+  it->second->second.apply(gen);
+  return true;
+}
+
+void fit::FitnessCache::insert(const genome &gen, size_t key, int capacity){
+  auto it = index.find(key);
+  if(it != index.end()){
+    entries.erase(it->second);
+    index.erase(it);
+  }
+  entries.emplace_front(key, Entry(gen));
+  index[key] = entries.begin();
+  while(entries.size() > capacity){
+    index.erase(entries.back().first);
+    entries.pop_back();
+  }
+}
+
+void fit::FitnessCache::clear(){
+  entries.clear();
+  index.clear();
+}
+
 float fit::FitnessStrategy::calculation(genome& gen, int freeSpace, executionConfig &eConf){
   // prepare parameters
   // Check if the gen is valid -> returns false if gen has distance 0
@@ -160,8 +336,6 @@ float fit::FitnessStrategy::calculation(genome& gen, int freeSpace, executionCon
     gen.fitness = 0;
     return 0;
   }
-  // Set calculated path --> Diversity estimation
-  gen.setPathSignature(eConf.gmap);
 
   // Time parameter:
 
@@ -252,8 +426,6 @@ float fit::FitnessSemiContinuous::calculation(genome &gen, int freeSpace, execut
     gen.fitness = 0;
     return 0;
   }
-  // Set calculated path
-  gen.setPathSignature(eConf.gmap);
 
   float cross_p = gen.cross / gen.traveledDist;
 
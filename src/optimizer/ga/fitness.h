@@ -3,6 +3,9 @@
 
 #include "../../tools/configuration.h"
 #include "../../tools/debug.h"
+#include "../../tools/robot_pool.h"
+#include <list>
+#include <unordered_map>
 
 namespace fit {
   using namespace conf;
@@ -15,14 +18,101 @@ namespace fit {
   void finalizeFitnessLogging(int poolsize, executionConfig& eConf);
   void trackPoolFitness(Genpool& pool, executionConfig& eConf);
   void fitnessFun(genome& gen, float x, float y, executionConfig& eConf);
+
+  /////////////////////////////////////////////////////////////////////////////
+  //                               FitnessCache                              //
+  /////////////////////////////////////////////////////////////////////////////
+
+  /**
+   * @brief      Bounded LRU cache of evaluation results.
+   *
+   * @details    Keys are structural hashes of evaluated gens
+   *             (genome::structuralHash). Since the hash includes the
+   *             counters of the last execution, only gens that were evaluated
+   *             before and did not change since can hit.
+   *             Every entry also keeps the number of actions and a second,
+   *             independent hash of the exact waypoints. A key collision
+   *             therefore is a miss and never returns the result of another
+   *             gen.
+   *             Stored values are taken before the pool bias is applied.
+   */
+  struct FitnessCache {
+    struct Entry {
+      Entry(const genome &gen);
+      void apply(genome &gen) const;
+      // Whether the entry was stored for gen and not for a gen with the same key
+      bool matches(const genome &gen) const;
+      // Hash of the waypoint bits, independent of genome::structuralHash
+      static size_t check(const genome &gen);
+
+      size_t actions, checksum;
+
+      float fitness, traveledDist, cross, p_obj, rotationCost, coverage;
+      int covered;
+      float pixelCrossCoverage, pathLengh, rotations;
+      bool reachEnd;
+      float finalCoverage, finalTime, finalRotationTime;
+      shared_ptr<const PathSignature> signature;
+      shared_ptr<Matrix> mat;
+    };
+    using Entries = list<pair<size_t, Entry>>;
+
+    // Copy the cached result to gen, return false if key is unknown or belongs to another gen
+    bool lookup(genome &gen, size_t key);
+    // Store the result of gen, the least recently used entry is dropped if the cache is full
+    void insert(const genome &gen, size_t key, int capacity);
+    void clear();
+    int size(){return entries.size();}
+
+    Entries entries;
+    unordered_map<size_t, Entries::iterator> index;
+  };
+
   struct FitnessStrategy {
 
     virtual void operator()(Genpool &currentPool, path::Robot &rob, executionConfig& eConf);
     virtual void operator()(FamilyPool& fPool, path::Robot &rob, executionConfig& eConf);
+    virtual void operator()(Genpool &currentPool, path::RobotPool &robots, executionConfig& eConf);
+    /**
+     * @brief      Evaluate the offspring (positions >= 2) of a single family.
+     *
+     * @details    Families can be evaluated concurrently with different
+     *             robots if cacheMtx guards the shared fitness cache.
+     */
+    void evaluateFamily(Genpool &family, path::Robot &rob, executionConfig& eConf, mutex *cacheMtx=nullptr);
 
     virtual void estimateGen(genome &gen, path::Robot &rob, executionConfig& eConf);
+    /**
+     * @brief      Evaluate the gen without tracking the logging parameter.
+     *
+     * @details    Only reads from eConf, all results are written to gen.
+     *             Can be called concurrently with different robots.
+     */
+    virtual void evaluateGen(genome &gen, path::Robot &rob, executionConfig& eConf);
+    /**
+     * @brief      Evaluate all gens with the robots of the pool.
+     *
+     * @details    The evaluation itself runs in parallel, the logging parameter
+     *             are tracked afterwards in the order of gens, which yields
+     *             the same values as calling estimateGen for each gen.
+     *
+     * @param      keepTrail store the coverage layer of each evaluation in gen.trail
+     */
+    void estimateGens(vector<genome*> &gens, path::RobotPool &robots, executionConfig& eConf, bool keepTrail=false);
+    /**
+     * @brief      Restore the evaluation of an unchanged gen from the cache.
+     *
+     * @details    Gens with modified actions are never restored.
+     *             Hits and misses are counted in eConf.
+     *
+     * @return     true if the gen does not need to be evaluated
+     */
+    bool restoreGen(genome &gen, executionConfig& eConf);
+    void storeGen(genome &gen, executionConfig& eConf);
     virtual float calculation(genome& gen, int freeSpace, executionConfig &eConf);
     virtual void applyPoolBias(Genpool& pool, executionConfig &eConf, bool useGlobal=false){;return;};
+
+    FitnessCache cache;
   };
 
   struct FitnessRotationBias : FitnessStrategy {
@@ -14,19 +14,24 @@ void mut::MutationStrategy::mutateGen(genome &gen, executionConfig &eConf) {
 }
 
 void mut::MutationStrategy::operator()(Genpool& currentPool, executionConfig& eConf){
-  for (auto &gen : currentPool) {
-    mutateGen(gen, eConf);
+  for (int i=0; i<currentPool.size(); i++) {
+    eConf.stream(rng::Op::Mutation, i);
+    mutateGen(currentPool[i], eConf);
   }
 }
 
 void mut::MutationStrategy::operator()(FamilyPool& fPool, executionConfig& eConf){
-  for (auto &family : fPool) {
-    if(family.size() == 2) continue;
-    assert(family.size() >= 4);
-    for(int i=2; i<family.size(); i++){
-      mutateGen(family[i], eConf);
-    }
-    // mutateGen(family[3], eConf);
+  for (int f=0; f<fPool.size(); f++) {
+    eConf.stream(rng::Op::Mutation, f);
+    mutateFamily(fPool[f], eConf);
+  }
+}
+
+void mut::MutationStrategy::mutateFamily(Genpool& family, executionConfig& eConf){
+  if(family.size() == 2) return;
+  assert(family.size() >= 4);
+  for(int i=2; i<family.size(); i++){
+    mutateGen(family[i], eConf);
   }
 }
 
@@ -38,6 +43,7 @@ bool mut::MutationStrategy::addOrthogonalAngleOffset(genome& gen, executionConfi
 
   // Select action and add the offset
   auto action = next(gen.actions.begin(), actionSelector(eConf.generator));
+  gen.detach(action);
   (*action)->mod_config[PAP::Angle] += changeDistro(eConf.generator) ? 90 : -90;
   (*action)->modified = true;
   gen.mutated = true;
@@ -51,6 +57,7 @@ bool mut::MutationStrategy::addRandomAngleOffset(genome& gen, executionConfig& e
   uniform_int_distribution<int> changeDistro(0,360);
   // Select action and add the offset
   auto action = next(gen.actions.begin(), actionSelector(eConf.generator));
+  gen.detach(action);
   (*action)->mod_config[PAP::Angle] += changeDistro(eConf.generator);
   (*action)->modified = true;
   gen.mutated = true;
@@ -64,6 +71,7 @@ void mut::MutationStrategy::addPositiveDistanceOffset(genome& gen, executionConf
   uniform_real_distribution<> changeDistro(0,eConf.mutaPosDistMax);
   // Select action and add the offset
   auto action = next(gen.actions.begin(), actionSelector(eConf.generator));
+  gen.detach(action);
   (*action)->mod_config[PAP::Distance] += changeDistro(eConf.generator);
   (*action)->modified = true;
   gen.mutated = true;
@@ -76,6 +84,7 @@ void mut::MutationStrategy::addNegativeDistanceOffset(genome& gen, executionConf
   uniform_real_distribution<> changeDistro(0,eConf.mutaPosDistMax);
   // Select action and add the offset
   auto action = next(gen.actions.begin(), actionSelector(eConf.generator));
+  gen.detach(action);
   float offset = changeDistro(eConf.generator);
   if((*action)->mod_config[PAP::Distance] > offset){
     (*action)->mod_config[PAP::Distance] -= offset;
@@ -92,6 +101,7 @@ bool mut::MutationStrategy::randomScaleDistance(genome& gen, executionConfig& eC
   uniform_real_distribution<float> changeDistro(0.5,1.5);
   // Select action and add the offset
   auto action = next(gen.actions.begin(), actionSelector(eConf.generator));
+  gen.detach(action);
   float offset = changeDistro(eConf.generator);
   // debug("Mut scale: ", offset);
   if((*action)->mod_config[PAP::Distance] > 0){
@@ -99,6 +109,7 @@ bool mut::MutationStrategy::randomScaleDistance(genome& gen, executionConfig& eC
     (*action)->modified = true;
   }else{
     // Use mean traveled distance to revive a zero action
+    gen.detach();
     gen.updateGenParameter();
     (*action)->mod_config[PAP::Distance] = (gen.traveledDist / gen.actions.size()) * offset;
   }
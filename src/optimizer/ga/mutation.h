@@ -26,6 +26,8 @@ namespace mut {
      * @param      eConf configuration
      */
     virtual void operator()(FamilyPool& fPool, executionConfig& eConf);
+    // Mutate the offspring (positions >= 2) of a single family
+    void mutateFamily(Genpool& family, executionConfig& eConf);
     void mutateGen(genome &gen, executionConfig &eConf);
     bool addOrthogonalAngleOffset(genome& gen, executionConfig& eConf);
     bool addRandomAngleOffset(genome& gen, executionConfig& eConf);
@@ -11,8 +11,7 @@ void sel::SelectionStrategy::operator()(Genpool& currentPool, SelectionPool& sel
   // Ensure population is not empty
   assert(currentPool.size() > 0);
   assert(eConf.selectKeepBest < currentPool.size());
-  // Keep the best individuals in the population for the next generation
-  sort(currentPool.begin(), currentPool.end());
+  // The pool is not sorted, RankedRWS ranks the gens by index (fitnessOrder)
   // eConf.best = currentPool.back();
   // keep.insert(keep.begin(),
   // 	      prev(currentPool.end(), eConf.selectKeepBest),
@@ -21,6 +20,15 @@ void sel::SelectionStrategy::operator()(Genpool& currentPool, SelectionPool& sel
   // Start selection process
   // TODO: Remember select individuals is now the value of the selected pairs!
   // int timeout = 0;
+  vector<int> parents;
+  eConf.stream(rng::Op::Selection);
+  if(selectIndices(currentPool, 2 * eConf.selectIndividuals, parents, eConf)){
+    for(int i=0; i+1 < parents.size(); i+=2){
+      selPool.push_back(make_pair(currentPool[parents[i]], currentPool[parents[i+1]]));
+      selPool.back().first.selected = true;
+      selPool.back().second.selected = true;
+    }
+  }
   while(selPool.size() < eConf.selectIndividuals){
     // Draw individuals
     auto couple = make_pair(selection(currentPool, eConf),
@@ -47,6 +55,7 @@ void sel::SelectionStrategy::operator()(Genpool& currentPool, SelectionPool& sel
 void sel::SelectionStrategy::uniformSelectionWithoutReplacement(Genpool &pool, FamilyPool &fPool, executionConfig &eConf){
   fPool.clear();
   // Shuffle will reorder the elements in random order
+  eConf.stream(rng::Op::Selection);
   shuffle(pool.begin(), pool.end(), eConf.generator);
   // sort(pool.begin(), pool.end());
   for (auto it = pool.begin(); it != pool.end();) {
@@ -63,15 +72,31 @@ void sel::SelectionStrategy::uniformSelectionWithoutReplacement(Genpool &pool, F
 
 // TODO: Move to own selection procedure class
 genome sel::SelectionStrategy::tournamentSelection(Genpool &pool, executionConfig &eConf){
-  deque<genome> turn;
-  shuffle(pool.begin(), pool.end(), eConf.generator);
-  turn.insert(turn.begin(), pool.begin(), next(pool.begin(), eConf.tournamentSize));
-  sort(turn.begin(), turn.end());
-  genome gen = turn.back();
+  genome gen = pool[tournamentIndex(pool, eConf)];
   gen.selected = true;
   return gen;
 }
 
+int sel::SelectionStrategy::tournamentIndex(const Genpool &pool, executionConfig &eConf){
+  assert(pool.size() > 0);
+  int size = pool.size();
+  int k = min(max(eConf.tournamentSize, 1), size);
+  // Floyd's algorithm: k distinct indices with k draws
+  vector<int> turn;
+  turn.reserve(k);
+  int best = -1;
+  for(int j = size - k; j < size; j++){
+    uniform_int_distribution<int> draw(0, j);
+    int idx = draw(eConf.generator);
+    if(find(turn.begin(), turn.end(), idx) != turn.end())
+      idx = j;
+    turn.push_back(idx);
+    if(best < 0 or pool[idx].fitness > pool[best].fitness)
+      best = idx;
+  }
+  return best;
+}
+
 
 void sel::SelectionStrategy::elitistSelection(FamilyPool& fPool, Genpool& pool){
   // select best two out of four
@@ -80,8 +105,7 @@ void sel::SelectionStrategy::elitistSelection(FamilyPool& fPool, Genpool& pool){
   for(auto &family : fPool){
     if(family.size() == 2) continue;
     assert(family.size() >= 4);
-    sort(family.begin(), family.end());
-    for(int i=family.size()-2; i<family.size(); i++){
+    for(int i : topK(family, 2)){
       // debug("Member: ", i, " Fsize: ", family.size());
       genome gen = family[i];
       gen.selected = true;
@@ -158,6 +182,69 @@ genome sel::RankedRWS::selection(Genpool &currentPopulation, executionConfig &eC
   return gen;
 }
 
+void sel::spinWheel(const vector<float> &cum, float low, float high, int count, bool sus, bool inclusive,
+		   int overflow, vector<int> &indices, rng::Philox &generator){
+  indices.resize(count);
+  auto slot = [&cum, inclusive, overflow](float value) -> int {
+    auto it = inclusive ? lower_bound(cum.begin(), cum.end(), value)
+      : upper_bound(cum.begin(), cum.end(), value);
+    return it == cum.end() ? overflow : it - cum.begin();
+  };
+  if(sus){
+    float step = (high - low) / count;
+    uniform_real_distribution<float> offset(0, step);
+    float pointer = low + offset(generator);
+    for(int i=0; i<count; i++, pointer += step)
+      indices[i] = slot(pointer);
+    // Pairs are formed from consecutive indices, mix the sorted pointers
+    shuffle(indices.begin(), indices.end(), generator);
+  }else{
+    uniform_real_distribution<float> wheel(low, high);
+    for(int i=0; i<count; i++)
+      indices[i] = slot(wheel(generator));
+  }
+}
+
+bool sel::RWS::selectIndices(Genpool &pool, int count, vector<int> &indices, executionConfig& eConf){
+  vector<float> cum(pool.size());
+  float sum = 0;
+  for(int i=0; i<pool.size(); i++){
+    sum += pool[i].fitness;
+    cum[i] = sum;
+  }
+  if(!(sum > 0))
+    return false;
+  // Rounding may exceed the wheel, use the last gen then
+  spinWheel(cum, 0, sum, count, eConf.selectSUS, false, pool.size() - 1, indices, eConf.generator);
+  return true;
+}
+
+bool sel::RankedRWS::selectIndices(Genpool &pool, int count, vector<int> &indices, executionConfig& eConf){
+  float SP = eConf.selPressure;
+  assert(SP >= 1);
+  assert(SP <= 2);
+  // Same rank values as selection, rank i belongs to the i-th worst gen
+  vector<int> order = fitnessOrder(pool);
+  vector<float> cum(pool.size());
+  float totalSum = 0;
+  for(int i=0; i<pool.size(); i++){
+    totalSum += 2.0-SP+2.0*(SP-1.0)*((i-1.0) / (pool.size()-1.0));
+    cum[i] = totalSum;
+  }
+  // The wheel exceeds the rank sum, like selection those draws yield the first gen
+  spinWheel(cum, 2-SP, pool.size(), count, eConf.selectSUS, true, 0, indices, eConf.generator);
+  for(int &idx : indices)
+    idx = order[idx];
+  return true;
+}
+
 genome sel::TournamentSelection::selection(Genpool &currentPopulation, executionConfig &eConf) {
   return tournamentSelection(currentPopulation, eConf);
 }
+
+bool sel::TournamentSelection::selectIndices(Genpool &pool, int count, vector<int> &indices, executionConfig& eConf){
+  indices.resize(count);
+  for(int i=0; i<count; i++)
+    indices[i] = tournamentIndex(pool, eConf);
+  return true;
+}
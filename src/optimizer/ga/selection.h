@@ -18,24 +18,51 @@ namespace sel {
     virtual void operator()(Genpool& currentPool, SelectionPool& selPool, executionConfig& eConf);
     // virtual void operator()(Genpool& currentPool, FamilyPool& selPool, executionConfig& eConf);
     virtual genome selection(Genpool &currentPopulation, executionConfig& eConf);
+    /**
+     * @brief      Draw count parents at once, given as indices into pool.
+     *
+     * @details    Strategies that do not support batched draws return false,
+     *             operator() then calls selection for every parent.
+     */
+    virtual bool selectIndices(Genpool &pool, int count, vector<int> &indices, executionConfig& eConf){return false;}
     // Shuffle pool and generate pairs of two which are contained in a vector and placed in the family pool
     void uniformSelectionWithoutReplacement(Genpool &pool, FamilyPool &fPool, executionConfig &eConf);
     // Select two best of four in the family
     void elitistSelection(FamilyPool& fPool, Genpool& pool);
     genome tournamentSelection(Genpool &pool, executionConfig &eConf);
+    // Index of the fittest of tournamentSize distinct random gens, the pool is not reordered
+    int tournamentIndex(const Genpool &pool, executionConfig &eConf);
     // void tournamentSelection(Genpool &pool, FamilyPool &fPool, executionConfig &eConf);
   };
 
+  /**
+   * @brief      Draw count indices from a roulette wheel.
+   *
+   * @details    cum holds the cumulative slot sizes, the wheel spans
+   *             [low, high). Each draw is a binary search in cum. With sus
+   *             (stochastic universal sampling) all indices are picked in
+   *             one pass with equally spaced pointers.
+   *             Slot i is hit for values below cum[i] (or equal if inclusive),
+   *             values past the last slot yield overflow.
+   */
+  void spinWheel(const vector<float> &cum, float low, float high, int count, bool sus, bool inclusive,
+		 int overflow, vector<int> &indices, rng::Philox &generator);
+
+  // Build the cumulative fitness table once and draw all parents from it
   struct RWS : SelectionStrategy{
     virtual genome selection(Genpool &currentPopulation, executionConfig& eConf) override;
+    virtual bool selectIndices(Genpool &pool, int count, vector<int> &indices, executionConfig& eConf) override;
   };
 
+  // selection expects the pool to be sorted by fitness, selectIndices ranks the gens itself
   struct RankedRWS : SelectionStrategy{
     virtual genome selection(Genpool &currentPopulation, executionConfig& eConf) override;
+    virtual bool selectIndices(Genpool &pool, int count, vector<int> &indices, executionConfig& eConf) override;
   };
 
   struct TournamentSelection : SelectionStrategy {
     virtual genome selection(Genpool &currentPopulation, executionConfig& eConf) override;
+    virtual bool selectIndices(Genpool &pool, int count, vector<int> &indices, executionConfig& eConf) override;
   };
 
 }
@@ -0,0 +1,335 @@
+#include "island.h"
+#include <cerrno>
+#include <cstring>
+#include <csignal>
+#include <stdexcept>
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/////////////////////////////////////////////////////////////////////////////
+//                                 Mailbox                                 //
+/////////////////////////////////////////////////////////////////////////////
+
+void op::Mailbox::post(genome gen){
+  Letter *letter = new Letter{std::move(gen), head.load(memory_order_relaxed)};
+  while(!head.compare_exchange_weak(letter->next, letter, memory_order_release, memory_order_relaxed));
+}
+
+Genpool op::Mailbox::collect(){
+  Letter *letter = head.exchange(nullptr, memory_order_acquire);
+  Genpool gens;
+  // The list holds the latest gen first
+  while(letter){
+    gens.push_front(std::move(letter->gen));
+    Letter *next = letter->next;
+    delete letter;
+    letter = next;
+  }
+  return gens;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//                               IslandModel                               //
+/////////////////////////////////////////////////////////////////////////////
+
+op::IslandModel::IslandModel(executionConfig eConf, Factory create)
+  :emigrants(max(eConf.islands, 1), 0),
+   immigrants(max(eConf.islands, 1), 0),
+   eConf(eConf),
+   create(create),
+   count(max(eConf.islands, 1)),
+   mailboxes(count){}
+
+shared_ptr<op::Optimizer> op::IslandModel::createIsland(int i){
+  executionConfig conf = eConf;
+  conf.island = i;
+  // Robots write their coverage into the map
+  conf.gmap = make_shared<GridMap>(*eConf.gmap);
+  conf.fitnessStr = make_shared<std::ostringstream>(std::ostringstream());
+  conf.logStr = make_shared<std::ostringstream>(std::ostringstream());
+  conf.logDir = eConf.logDir + "/island_" + to_string(i);
+  seed_seq seed{eConf.genSeed, i};
+  conf.generator.seed(seed);
+  // Only the first island shows its best path
+  conf.visualize = eConf.visualize and i == 0;
+  auto opti = create(conf);
+  opti->migration = [this, i](Genpool &pool, executionConfig &conf){
+    migrate(i, pool, conf);
+  };
+  return opti;
+}
+
+void op::IslandModel::runPhase(Optimizer &opti, bool retrain, bool display){
+  if(retrain){
+    mapgen::emulateCoveredMapSegment(opti.eConf.gmap, opti.eConf.start);
+    opti.eConf.maxIterations = opti.eConf.retrain;
+  }
+  opti.optimize(display);
+}
+
+void op::IslandModel::run(bool display){
+  if(islands.empty())
+    for(int i=0; i<count; i++)
+      islands.push_back(createIsland(i));
+
+  for(int phase=0; phase < (eConf.retrain ? 2 : 1); phase++){
+    // Migrants of the previous phase are outdated
+    for(int i=0; i<count; i++){
+      mailboxes[i].collect();
+      emigrants[i] = immigrants[i] = 0;
+    }
+    vector<thread> threads;
+    for(int i=0; i<count; i++)
+      threads.emplace_back([this, i, phase, display](){
+	runPhase(*islands[i], phase == 1, display and i == 0);
+      });
+    for(auto &t : threads)
+      t.join();
+
+    vector<genome> bests;
+    vector<int> iterations;
+    vector<string> islandLogs;
+    for(auto &opti : islands){
+      bests.push_back(opti->eConf.best);
+      iterations.push_back(opti->eConf.currentIter);
+      islandLogs.push_back(opti->eConf.logDir);
+    }
+    finish(phase == 1 ? eConf.logDir + "/retrain_run" : eConf.logDir, bests, iterations, islandLogs);
+  }
+}
+
+void op::IslandModel::finish(const string &logDir, const vector<genome> &bests, const vector<int> &iterations,
+			     const vector<string> &islandLogs){
+  ostringstream summary;
+  summary << "Island,Iterations,BestFit,BestTime,BestCov,BestLen,Emigrants,Immigrants\n";
+  best = bests.front();
+  for(int i=0; i<bests.size(); i++){
+    if(bests[i].fitness > best.fitness)
+      best = bests[i];
+    summary << argsToCsv(i,
+			 iterations[i],
+			 bests[i].fitness,
+			 bests[i].finalTime,
+			 bests[i].finalCoverage,
+			 bests[i].actions.size(),
+			 emigrants[i],
+			 immigrants[i]);
+  }
+  logging::Logger(summary.str(), logDir, "islands");
+
+  // Rows of all islands in one log, they are distinguished by the column Island
+  ostringstream combined;
+  for(int i=0; i<islandLogs.size(); i++){
+    ifstream in(islandLogs[i] + "/" + eConf.logName + ".csv");
+    string line;
+    if(getline(in, line) and i == 0)
+      combined << line << "\n";
+    while(getline(in, line))
+      combined << line << "\n";
+  }
+  if(!combined.str().empty())
+    logging::Logger(combined.str(), logDir, eConf.logName);
+}
+
+bool op::IslandModel::post(int target, const genome &gen){
+  // The receiver gets private actions
+  genome copy = gen;
+  copy.detach();
+  mailboxes[target].post(std::move(copy));
+  return true;
+}
+
+Genpool op::IslandModel::collect(int island, executionConfig &conf){
+  return mailboxes[island].collect();
+}
+
+void op::IslandModel::migrate(int island, Genpool &pool, executionConfig &conf){
+  conf.migrants = 0;
+  if(count < 2 or pool.empty())
+    return;
+
+  if(conf.currentIter > 0 and conf.currentIter % max(eConf.migrationInterval, 1) == 0){
+    uniform_int_distribution<int> other(1, count - 1);
+    conf.stream(rng::Op::Migration);
+    for(int idx : topK(pool, eConf.migrationSize)){
+      int target = eConf.migrationTopology == 0
+	? (island + 1) % count
+	: (island + other(conf.generator)) % count;
+      if(post(target, pool[idx]))
+	emigrants[island]++;
+    }
+  }
+
+  // Immigrants replace the worst gens
+  Genpool arrived = collect(island, conf);
+  auto worst = bottomK(pool, arrived.size());
+  for(int i=0; i<worst.size(); i++)
+    pool[worst[i]] = std::move(arrived[i]);
+  conf.migrants = worst.size();
+  immigrants[island] += worst.size();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//                             ProcessIslands                              //
+/////////////////////////////////////////////////////////////////////////////
+
+// Restrict the calling process to the cpus of NUMA node island % nodes
+static void pinToNode(int island){
+  vector<string> cpulists;
+  for(int node=0; ; node++){
+    ifstream in("/sys/devices/system/node/node" + to_string(node) + "/cpulist");
+    string list;
+    if(!getline(in, list))
+      break;
+    cpulists.push_back(list);
+  }
+  if(cpulists.empty())
+    return;
+
+  // Format: 0-7,16-23
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  stringstream ss(cpulists[island % cpulists.size()]);
+  string range;
+  while(getline(ss, range, ',')){
+    auto dash = range.find('-');
+    int first = stoi(range);
+    int last = dash == string::npos ? first : stoi(range.substr(dash + 1));
+    for(int cpu=first; cpu<=last; cpu++)
+      CPU_SET(cpu, &cpus);
+  }
+  if(sched_setaffinity(0, sizeof(cpus), &cpus) != 0)
+    warn("Cannot pin island ", island, " to its NUMA node");
+}
+
+op::ProcessIslands::ProcessIslands(executionConfig eConf, Factory create):IslandModel(eConf, create){
+  // A cell holds the results, up to 2048 actions and the signature of a gen
+  auto mapSize = eConf.gmap->getSize();
+  size_t cells = static_cast<size_t>(mapSize(0)) * mapSize(1);
+  size_t slotBytes = 256 + 2048 * 58 + cells * 8;
+  if(slotBytes > numeric_limits<uint32_t>::max())
+    throw runtime_error("Map too large for island messages: " + to_string(cells) + " cells");
+  uint32_t slotSize = slotBytes;
+  uint32_t inboxSlots = max(8, 2 * count * eConf.migrationSize);
+  size_t inboxBytes = shm::Ring::bytes(inboxSlots, slotSize);
+  // One result per phase
+  size_t resultBytes = shm::Ring::bytes(2, slotSize);
+
+  segment = make_unique<shm::Segment>("/opti_islands_" + to_string(getpid()),
+				      64 + count * (inboxBytes + resultBytes));
+  finished = new (segment->data) atomic<uint32_t>(0);
+  char *mem = segment->data + 64;
+  for(int i=0; i<count; i++){
+    inboxes.push_back(shm::Ring::create(mem, inboxSlots, slotSize));
+    mem += inboxBytes;
+    results.push_back(shm::Ring::create(mem, 2, slotSize));
+    mem += resultBytes;
+  }
+}
+
+void op::ProcessIslands::run(bool display){
+  // Buffered output would be printed by every process
+  cout.flush();
+  vector<pid_t> pids;
+  for(int i=0; i<count; i++){
+    pid_t pid = fork();
+    if(pid < 0){
+      string msg = "Cannot start island process " + to_string(i) + ": " + strerror(errno);
+      warn(msg);
+      // The started islands would wait for the missing ones forever
+      for(pid_t started : pids)
+	kill(started, SIGKILL);
+      for(pid_t started : pids)
+	waitpid(started, nullptr, 0);
+      throw runtime_error(msg);
+    }
+    if(pid == 0){
+      runIsland(i, display and i == 0);
+      cout.flush();
+      _exit(0);
+    }
+    pids.push_back(pid);
+  }
+
+  // Reap in order of termination, running islands may wait for a failed one
+  for(int running = pids.size(); running > 0;){
+    int status;
+    pid_t pid = wait(&status);
+    if(pid < 0){
+      if(errno == EINTR)
+	continue;
+      warn("Cannot wait for island processes: ", strerror(errno));
+      break;
+    }
+    running--;
+    if(!WIFEXITED(status) or WEXITSTATUS(status) != 0){
+      warn("Island process ", pid, " failed!");
+      // Do not let the other islands wait for it
+      finished->fetch_add(1);
+    }
+  }
+
+  for(int phase=0; phase < (eConf.retrain ? 2 : 1); phase++){
+    vector<genome> bests(count);
+    vector<int> iterations(count, 0);
+    vector<string> islandLogs;
+    for(int i=0; i<count; i++){
+      islandLogs.push_back(eConf.logDir + "/island_" + to_string(i) + (phase == 1 ? "/retrain_run" : ""));
+      int32_t header[3];
+      if(!results[i]->pop(buffer) or buffer.size() < sizeof(header))
+	continue;
+      memcpy(header, buffer.data(), sizeof(header));
+      iterations[i] = header[0];
+      emigrants[i] = header[1];
+      immigrants[i] = header[2];
+      pa_serializer::decodeGenome(buffer.data() + sizeof(header), buffer.size() - sizeof(header), bests[i]);
+    }
+    finish(phase == 1 ? eConf.logDir + "/retrain_run" : eConf.logDir, bests, iterations, islandLogs);
+  }
+}
+
+void op::ProcessIslands::runIsland(int i, bool display){
+  if(eConf.pinNuma)
+    pinToNode(i);
+  // Created after pinning, the memory of the island is local to its node
+  islands.assign(count, nullptr);
+  islands[i] = createIsland(i);
+  Optimizer &opti = *islands[i];
+
+  for(int phase=0; phase < (eConf.retrain ? 2 : 1); phase++){
+    if(phase == 1){
+      // Wait until every island finished, migrants of the first phase are outdated
+      finished->fetch_add(1);
+      while(finished->load() < count)
+	this_thread::sleep_for(chrono::milliseconds(1));
+      collect(i, opti.eConf);
+    }
+    emigrants[i] = immigrants[i] = 0;
+    runPhase(opti, phase == 1, display);
+
+    // Report to the coordinator
+    int32_t header[3] = {opti.eConf.currentIter, emigrants[i], immigrants[i]};
+    vector<char> gen;
+    pa_serializer::encodeGenome(opti.eConf.best, gen);
+    buffer.assign(reinterpret_cast<char*>(header), reinterpret_cast<char*>(header) + sizeof(header));
+    buffer.insert(buffer.end(), gen.begin(), gen.end());
+    if(!results[i]->push(buffer))
+      warn("Island ", i, ": best gen exceeds the result buffer!");
+  }
+}
+
+bool op::ProcessIslands::post(int target, const genome &gen){
+  pa_serializer::encodeGenome(gen, buffer);
+  return inboxes[target]->push(buffer);
+}
+
+Genpool op::ProcessIslands::collect(int island, executionConfig &conf){
+  Genpool arrived;
+  while(inboxes[island]->pop(buffer)){
+    genome gen;
+    if(pa_serializer::decodeGenome(buffer.data(), buffer.size(), gen, conf.diversitySketch))
+      arrived.push_back(std::move(gen));
+  }
+  return arrived;
+}
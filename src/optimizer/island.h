@@ -0,0 +1,136 @@
+#ifndef ISLAND_H
+#define ISLAND_H
+
+#include "optimizer.h"
+#include "../tools/shm_ring.h"
+#include <thread>
+
+namespace op {
+
+  /////////////////////////////////////////////////////////////////////////////
+  //                                 Mailbox                                 //
+  /////////////////////////////////////////////////////////////////////////////
+
+  /**
+   * @brief      Lock free inbox of an island.
+   *
+   * @details    Any island can post gens (multiple producers), only the
+   *             owning island collects them. Posted gens are pushed onto an
+   *             atomic list, collect takes the whole list at once.
+   */
+  struct Mailbox {
+    Mailbox(){}
+    Mailbox(const Mailbox&) = delete;
+    Mailbox& operator=(const Mailbox&) = delete;
+    ~Mailbox(){collect();}
+
+    void post(genome gen);
+    // Take all gens that were posted so far (in posting order)
+    Genpool collect();
+
+  private:
+    struct Letter {
+      genome gen;
+      Letter *next;
+    };
+    atomic<Letter*> head{nullptr};
+  };
+
+  /////////////////////////////////////////////////////////////////////////////
+  //                               IslandModel                               //
+  /////////////////////////////////////////////////////////////////////////////
+
+  /**
+   * @brief      Independent sub-populations that run on separate threads.
+   *
+   * @details    Every island is an Optimizer with its own configuration
+   *             (seeded with genSeed and the island index), map copy, robot
+   *             and operators created by the given factory. Every
+   *             migrationInterval iterations an island sends copies of its
+   *             migrationSize best gens to the next island (ring) or to
+   *             random islands, received gens replace the worst gens of the
+   *             pool. Islands do not wait for each other.
+   *             Actions are allocated in the arena of the island
+   *             (Optimizer::arena), immigrants are copied into it with the
+   *             next generation.
+   *             Each island logs to logDir/island_<i>/, the summary of all
+   *             islands is written to logDir/islands.csv and the rows of all
+   *             islands are merged into logDir/<logName>.csv.
+   */
+  struct IslandModel {
+    using Factory = function<shared_ptr<Optimizer>(executionConfig)>;
+
+    IslandModel(executionConfig eConf, Factory create);
+    IslandModel(const IslandModel&) = delete;
+    IslandModel& operator=(const IslandModel&) = delete;
+    virtual ~IslandModel(){}
+
+    // Run the scenario on all islands (followed by the retrain phase) until every island finished
+    virtual void run(bool display = false);
+    // Called by island once per iteration (Optimizer::migration)
+    void migrate(int island, Genpool &pool, executionConfig &conf);
+    // Optimizer of island i with its own configuration and the migration hook
+    shared_ptr<Optimizer> createIsland(int i);
+    // Run the scenario of opti, the retrain phase marks the covered map segment first
+    static void runPhase(Optimizer &opti, bool retrain, bool display);
+    // Select the best gen of a finished phase and write the summary and combined log to logDir
+    void finish(const string &logDir, const vector<genome> &bests, const vector<int> &iterations,
+		const vector<string> &islandLogs);
+    int size() const {return count;}
+
+    // Best gen of all islands after run
+    genome best;
+    vector<shared_ptr<Optimizer>> islands;
+    // Gens sent and received per island (only written by the island itself)
+    vector<int> emigrants, immigrants;
+    executionConfig eConf;
+
+  protected:
+    // Transport of the migrants, post returns false if the gen was not sent
+    virtual bool post(int target, const genome &gen);
+    virtual Genpool collect(int island, executionConfig &conf);
+
+    Factory create;
+    int count;
+    vector<Mailbox> mailboxes;
+  };
+
+  /////////////////////////////////////////////////////////////////////////////
+  //                             ProcessIslands                              //
+  /////////////////////////////////////////////////////////////////////////////
+
+  /**
+   * @brief      Island model with one process per island.
+   *
+   * @details    The calling process (coordinator) forks the islands and
+   *             waits for them. With pinNuma an island is restricted to the
+   *             cpus of NUMA node i % nodes before its optimizer is created,
+   *             the memory of the island is then allocated on that node.
+   *             Migrants are encoded with pa_serializer::encodeGenome and
+   *             sent through one shm::Ring per island in a POSIX shared
+   *             memory segment. Islands report their best gen through a
+   *             second ring, the coordinator merges the results and writes
+   *             the logs like IslandModel. Gens that exceed a ring cell are
+   *             not sent.
+   */
+  struct ProcessIslands : IslandModel {
+    ProcessIslands(executionConfig eConf, Factory create);
+
+    void run(bool display = false) override;
+
+  protected:
+    bool post(int target, const genome &gen) override;
+    Genpool collect(int island, executionConfig &conf) override;
+    // Body of the process of island i
+    void runIsland(int i, bool display);
+
+    unique_ptr<shm::Segment> segment;
+    vector<shm::Ring*> inboxes;
+    vector<shm::Ring*> results;
+    // Islands that finished the first phase (all wait before the retrain phase)
+    atomic<uint32_t> *finished;
+    vector<char> buffer;
+  };
+}
+
+#endif /* ISLAND_H */
@@ -13,7 +13,7 @@ void op::Optimizer::logAndSnapshotPool(executionConfig& eConf){
 
   // Write initial logfile
   if(eConf.currentIter == 0){
-      *eConf.logStr << "Iteration,FitAvg,FitMax,FitMin,TimeAvg,TimeMax,TimeMin,CovAvg,CovMax,CovMin,AngleAvg,AngleMax,AngleMin,ObjCountAvg,ObjCountMax,ObjCountMin,PathLenAvg,PathLenMax,PathLenMin,AcLenAvg,AcLenMax,AcLenMin,ZeroAcPercent,DGens,BestTime,BestCov,BestAngle,BestLen,BestPathLen,BestDiv,BestObj,BestCross,BestTraveled,BestPathLen,DivMean,DivStd,DivMax,DivMin,PopFilled,PopSize,CrossFailed,MutaCount,Duration\n";
+      *eConf.logStr << "Iteration,FitAvg,FitMax,FitMin,TimeAvg,TimeMax,TimeMin,CovAvg,CovMax,CovMin,AngleAvg,AngleMax,AngleMin,ObjCountAvg,ObjCountMax,ObjCountMin,PathLenAvg,PathLenMax,PathLenMin,AcLenAvg,AcLenMax,AcLenMin,ZeroAcPercent,DGens,BestTime,BestCov,BestAngle,BestLen,BestPathLen,BestDiv,BestObj,BestCross,BestTraveled,BestPathLen,DivMean,DivStd,DivMax,DivMin,PopFilled,PopSize,CrossFailed,MutaCount,Duration,CacheHits,CacheMisses,ActionAllocs,DivError,Island,Migrants,Evaluations,EvalsPerSec,ActionRetained,CompactTime\n";
       logging::Logger(eConf.logStr->str(), eConf.logDir, eConf.logName);
       eConf.logStr->str("");
   }
@@ -62,9 +62,21 @@ void op::Optimizer::logAndSnapshotPool(executionConfig& eConf){
 				    eConf.popSize,
 				    eConf.crossFailed,
 				    eConf.mutaCount,
-				    duration.count()
+				    duration.count(),
+				    eConf.cacheHits,
+				    eConf.cacheMisses,
+				    eConf.actionAllocs,
+				    eConf.diversityError,
+				    eConf.island,
+				    eConf.migrants,
+				    eConf.evaluations,
+				    eConf.evalRate,
+				    eConf.actionRetained,
+				    eConf.compactTime
 				    );
     }
+   // Counted per iteration
+   eConf.cacheHits = eConf.cacheMisses = 0;
     if(eConf.takeSnapshot && (eConf.currentIter % eConf.takeSnapshotEvery == 0)){
       // debug("Take snapshot to: ", eConf.tSnap);
       snapshotPopulation(eConf);
@@ -138,6 +150,17 @@ void op::Optimizer::snapshotPopulation(executionConfig& eConf){
 }
 
 
+void op::trackDiversity(Genpool& pool, DiversityMatrix& divMat, executionConfig& eConf){
+  eConf.stream(rng::Op::Diversity);
+  if(eConf.diversitySketch > 0)
+    getDivMeanStd(pool, eConf.diversityMean, eConf.diversityStd, eConf.diversityMin, eConf.diversityMax,
+		  eConf.diversitySamples, eConf.generator, eConf.diversityError);
+  else if(eConf.incrementalDiversity)
+    getDivMeanStd(pool, divMat, eConf.diversityMean, eConf.diversityStd, eConf.diversityMin, eConf.diversityMax);
+  else
+    getDivMeanStd(pool, eConf.diversityMean, eConf.diversityStd, eConf.diversityMin, eConf.diversityMax);
+}
+
 void op::getBestGen(Genpool& pool, executionConfig& eConf){
   // for (auto it = pool.begin(); it != pool.end(); ++it) {
   //   debug("Pool Div", it->diversityFactor);
@@ -162,6 +185,12 @@ void op::getBestGen(Genpool& pool, executionConfig& eConf){
   }
 }
 
+void op::limitEigenThreads(const executionConfig& eConf){
+  int parallel = max(eConf.evalThreads, 1) * max(eConf.islands, 1);
+  if(parallel > 1)
+    Eigen::setNbThreads(max(1, static_cast<int>(thread::hardware_concurrency()) / parallel));
+}
+
 void op::adaptCrossover(executionConfig& eConf){
   float lower = 0.4;
   float upper = 0.85;
@@ -208,25 +237,23 @@ void op::clearZeroPAs(Genpool& pool, executionConfig& eConf){
 }
 
 
-void op::Optimizer::saveBest(Genpool& pool, executionConfig& eConf, bool sortPool){
-  elite.clear();
-  if(sortPool)
-    sort(pool.begin(), pool.end());
-  elite.insert(elite.begin(), pool.begin(), pool.end());
+void op::Optimizer::saveBest(Genpool& pool, executionConfig& eConf){
+  elite.assign(pool.begin(), pool.end());
+  eliteBest = topK(elite, eConf.selectKeepBest);
 }
 
 void op::Optimizer::replaceWithBest(Genpool& pool, executionConfig& eConf){
   if(elite.size() == 0) return;
-  sort(pool.begin(), pool.end());
-  pool.erase(pool.begin(),next(pool.begin(), eConf.selectKeepBest));
-  pool.insert(pool.begin(), prev(elite.end(), eConf.selectKeepBest), elite.end());
+  // Overwrite the worst gens
+  auto worst = bottomK(pool, eliteBest.size());
+  for(int i=0; i<worst.size(); i++)
+    pool[worst[i]] = elite[eliteBest[i]];
 }
 
 void op::Optimizer::insertBest(Genpool& pool, executionConfig& eConf){
   if(elite.size() == 0) return;
-  // sort(pool.begin(), pool.end());
-  // pool.erase(pool.begin(),next(pool.begin(), eConf.selectKeepBest));
-  pool.insert(pool.end(), prev(elite.end(), eConf.selectKeepBest), elite.end());
+  for(int idx : eliteBest)
+    pool.push_back(elite[idx]);
 }
 
 
@@ -235,8 +262,13 @@ void op::Optimizer::balancePopulation(Genpool& pool, executionConfig& eConf){
   if(pool.size() < eConf.popMin){
     // debug("Adjust Pop");
     int missing = eConf.popMin - pool.size();
-    shuffle(elite.begin(), elite.end(), eConf.generator);
-    pool.insert(pool.end(), elite.begin(), next(elite.begin(), missing));
+    // Random elites, shuffle the indices to keep eliteBest valid
+    vector<int> order(elite.size());
+    iota(order.begin(), order.end(), 0);
+    eConf.stream(rng::Op::Selection, 1);
+    shuffle(order.begin(), order.end(), eConf.generator);
+    for(int i=0; i<missing; i++)
+      pool.push_back(elite[order[i]]);
     eConf.popFilled = missing;
   }
     // debug("No population adjustment");
@@ -248,8 +280,9 @@ void op::Optimizer::balancePopulation(Genpool& pool, executionConfig& eConf){
 ///////////////////////////////////////////////////////////////////////////////
 
 void op::Optimizer::optimizePath(bool display){
+  auto scope = arenaScope();
 
-  CrossoverStrategy *crossing;
+  DualPointCrossover *crossing;
   DualPointCrossover DualCross;
   SameStartDualPointCrossover sIdxCross;
   if(eConf.crossStrategy == 0)
@@ -284,15 +317,21 @@ void op::Optimizer::optimizePath(bool display){
     // eConf.tSnap = "retrain_pool.actions";
     // eConf.tPerformanceSnap = "retrain_pool.performance";
     rob->getFreeArea(true);
+    // The covered layer changed, recorded coverage is outdated
+    rob->invalidateCheckpoints();
+    fs->cache.clear();
   }
+  // Worker robots copy the current map (covered layer may have changed)
+  robots = RobotPool(rob, eConf.evalThreads);
 
   // Main loop
-  (*fs)(pool, *rob, eConf);
+  (*fs)(pool, robots, eConf);
   while(eConf.currentIter <= eConf.maxIterations){
     // debug("test");
+    nextGeneration();
     // Logging
     // debug("Size: ", pool.size());
-    getDivMeanStd(pool, eConf.diversityMean, eConf.diversityStd, eConf.diversityMin, eConf.diversityMax);
+    trackDiversity(pool, diversity, eConf);
     getBestGen(pool, eConf);
     trackPoolFitness(pool, eConf);
     eConf.deadGensCount = countDeadGens(pool, eConf.getMinGenLen(), eConf.mapResolution);
@@ -303,33 +342,34 @@ void op::Optimizer::optimizePath(bool display){
     if (checkEndCondition())
       break;
     // assert(eConf.actionLenAvg < 300);
+    if(migration)
+      migration(pool, eConf);
 
     // Selection
 
     saveBest(pool, eConf);
       select->uniformSelectionWithoutReplacement(pool, fPool, eConf);
 
-      // Crossover
-      (*crossing)(fPool, pool, eConf);
+      // Crossover, mutation and evaluation of the families
+      evolveFamilies(*crossing, *fs);
       // debug("After Cross: ", pool.size());
       // Mutate remaining individuals in pool
       clearZeroPAs(pool, eConf);
       if (pool.size() > 2){
-	for (auto it = pool.begin(); it != next(pool.begin(), pool.size() - 1); ++it) {
+	vector<genome*> replaced;
+	// Keep the best gen
+	int best = topK(pool, 1).front();
+	for (int i=0; i<pool.size(); i++) {
 	  // Replace worst gen with random
-	  if(mutate->randomReplaceGen(*it, eConf)){
-	    fs->estimateGen(*it, *rob, eConf);
-	    it->trail = 1 * (*eConf.gmap)["map"];
-	  }
+	  eConf.stream(rng::Op::Replace, i);
+	  if(i != best and mutate->randomReplaceGen(pool[i], eConf))
+	    replaced.push_back(&pool[i]);
 	}
+	fs->estimateGens(replaced, robots, eConf, eConf.keepTrail);
       }
-      // Mutation
-      (*mutate)(fPool, eConf);
-      (*fs)(fPool, *rob, eConf);
 
       select->elitistSelection(fPool, pool);
       // Second mutation stage:
-      sort(pool.begin(), pool.end());
       replaceWithBest(pool, eConf);
       // debug("Size:", pool.size());
 
@@ -340,6 +380,91 @@ void op::Optimizer::optimizePath(bool display){
   logging::Logger(eConf.logStr->str(), eConf.logDir, eConf.logName, true);
 }
 
+ActionArena::Scope op::Optimizer::arenaScope(){
+  if(eConf.actionArena and !arena)
+    arena = ActionArena::create();
+  return ActionArena::Scope(arena.get());
+}
+
+void op::Optimizer::nextGeneration(){
+  if(!eConf.actionArena)
+    return;
+  // Rebuilt by the selection before they are used again
+  sPool.clear();
+  fPool.clear();
+
+  // Keep the arena while most of its objects are alive
+  size_t allocs = arena ? arena->allocations() : 0;
+  eConf.actionAllocs = allocs - arenaAllocs;
+  arenaAge++;
+  float live = allocs > 0 ? float(arena->objects()) / allocs : 0;
+  bool due = eConf.arenaCompactEvery > 0 and arenaAge >= eConf.arenaCompactEvery;
+  if(arena and live >= eConf.arenaCompactBelow and !due){
+    arenaAllocs = allocs;
+    eConf.actionRetained = arena->used();
+    eConf.compactTime = 0;
+    return;
+  }
+
+  auto t_start = high_resolution_clock::now();
+  shared_ptr<ActionArena> previous = arena;
+  arena = ActionArena::create();
+  ActionArena::install(arena.get());
+
+  // Copy the survivors into the new arena, actions shared by gens stay shared
+  unordered_map<const PathAction*, shared_ptr<PathAction>> moved;
+  auto compact = [&moved](genome &gen){
+    for(auto &pa : gen.actions){
+      auto &copy = moved[pa.get()];
+      if(!copy)
+	copy = pa->clone();
+      pa = copy;
+    }
+  };
+  for(auto *gens : {&pool, &sel, &elite})
+    for(auto &gen : *gens)
+      compact(gen);
+  compact(eConf.best);
+  moved.clear();
+  eConf.compactTime = duration_cast<microseconds>(high_resolution_clock::now() - t_start).count();
+
+  arenaAllocs = arena->allocations();
+  arenaAge = 0;
+  // Memory of the old arena is kept only if actions outside of the optimizer reference it
+  eConf.actionRetained = arena->used() + (previous and previous->objects() > 0 ? previous->memory() : 0);
+}
+
+void op::Optimizer::evolveFamilies(DualPointCrossover &crossing, FitnessStrategy &fs){
+  assert(fPool.size() > 0);
+  vector<executionConfig> confs(robots.size(), eConf);
+  for(auto &conf : confs)
+    conf.cacheHits = conf.cacheMisses = 0;
+  vector<uint8_t> mated(fPool.size(), false);
+  mutex cacheMtx;
+
+  robots.steal(fPool.size(), [&](int f, int w){
+    executionConfig &conf = confs[w];
+    conf.stream(rng::Op::Crossover, f);
+    if(!crossing.mateFamily(fPool[f], conf))
+      return;
+    mated[f] = true;
+    conf.stream(rng::Op::Mutation, f);
+    mutate->mutateFamily(fPool[f], conf);
+    fs.evaluateFamily(fPool[f], *robots.robots[w], conf, &cacheMtx);
+  });
+
+  for(int f=0; f<fPool.size(); f++){
+    if(mated[f])
+      continue;
+    pool.push_back(fPool[f][0]);
+    pool.push_back(fPool[f][1]);
+  }
+  for(auto &conf : confs){
+    eConf.cacheHits += conf.cacheHits;
+    eConf.cacheMisses += conf.cacheMisses;
+  }
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////
 //                       Tournament Selection Scenario                       //
@@ -347,6 +472,7 @@ void op::Optimizer::optimizePath(bool display){
 
 
 void op::Optimizer::optimizePath_Turn_RWS(bool display){
+  auto scope = arenaScope();
 
   CrossoverStrategy *crossing;
   DualPointCrossover DualCross;
@@ -394,23 +520,29 @@ void op::Optimizer::optimizePath_Turn_RWS(bool display){
   }else{
     eConf.currentIter = 0;
     rob->getFreeArea(true);
+    // The covered layer changed, recorded coverage is outdated
+    rob->invalidateCheckpoints();
+    fs->cache.clear();
     // Magic with the logger to keep old performance data
     eConf.logDir += "/retrain_run";
     // eConf.tSnap = "retrain_pool.actions";
     // eConf.tPerformanceSnap = "retrain_pool.performance";
   }
+  // Worker robots copy the current map (covered layer may have changed)
+  robots = RobotPool(rob, eConf.evalThreads);
 
   // Main loop
-  (*fs)(pool, *rob, eConf);
+  (*fs)(pool, robots, eConf);
 
   while(eConf.currentIter <= eConf.maxIterations){
 
 
+    nextGeneration();
     // Logging
     eConf.deadGensCount = countDeadGens(pool, eConf.getMinGenLen(), eConf.mapResolution);
     // debug("Size: ", pool.size(), " dead: ", eConf.deadGensCount);
     eConf.zeroActionPercent = calZeroActionPercent(pool, eConf.mapResolution);
-    getDivMeanStd(pool, eConf.diversityMean, eConf.diversityStd, eConf.diversityMin, eConf.diversityMax);
+    trackDiversity(pool, diversity, eConf);
     getBestGen(pool, eConf);
     saveBest(pool, eConf);
     clearZeroPAs(pool, eConf);
@@ -420,18 +552,21 @@ void op::Optimizer::optimizePath_Turn_RWS(bool display){
     fs->applyPoolBias(pool, eConf);
     if (checkEndCondition())
 	break;
+    if(migration)
+      migration(pool, eConf);
 
 
     // Selection
     (*selection)(pool, sPool, eConf);
     insertBest(pool, eConf);
-    // Crossover
-    mPool.clear();
-    (*crossing)(sPool, mPool, eConf);
+    // Crossover, parents of failed pairs join the offspring unless they are elites
+    (*crossing)(sPool, mPool, eConf, &pool);
 
     // Mutation
     eConf.mutaCount = 0;
+    vector<genome*> offspring;
     for (auto it = mPool.begin(); it != mPool.end(); ++it) {
+      eConf.stream(rng::Op::Mutation, it - mPool.begin());
       bool mutated = mutate->randomReplaceGen(*it, eConf);
       if(not mutated){
 	mutated |= mutate->addRandomAngleOffset(*it, eConf);
@@ -443,10 +578,13 @@ void op::Optimizer::optimizePath_Turn_RWS(bool display){
 	eConf.mutaCount++;
       // clearZero
       // removeZeroPAs(*it, eConf.mapResolution/2);
-      fs->estimateGen(*it, *rob, eConf);
+      offspring.push_back(&(*it));
     }
+    fs->estimateGens(offspring, robots, eConf);
 
     pool.insert(pool.end(), mPool.begin(), mPool.end());
+    // The offspring lives on in the pool only
+    mPool.clear();
     balancePopulation(pool, eConf);
     // Keep best individual
     // pool.push_back(eConf.best);
@@ -457,3 +595,173 @@ void op::Optimizer::optimizePath_Turn_RWS(bool display){
   // Log Fitnessvalues for all iterations
   logging::Logger(eConf.logStr->str(), eConf.logDir, eConf.logName, true);
 }
+
+
+///////////////////////////////////////////////////////////////////////////////
+//                           Steady State Scenario                           //
+///////////////////////////////////////////////////////////////////////////////
+
+
+void op::Optimizer::optimizePath_SteadyState(bool display){
+  // Only the initial population is allocated in the arena, workers use make_shared
+  auto scope = arenaScope();
+
+  DualPointCrossover DualCross;
+  SameStartDualPointCrossover sIdxCross;
+  DualPointCrossover *crossing = eConf.crossStrategy == 1 ? &sIdxCross : &DualCross;
+
+  FitnessStrategy *fs;
+  FitnessStrategy fit_base;
+  FitnessRotationBias fit_rot;
+  fit::FitnessSemiContinuous fit_scont;
+
+  if(eConf.fitSselect == 0)
+    fs = &fit_base;
+  else if(eConf.fitSselect == 1)
+    fs = &fit_rot;
+  else
+    fs = &fit_scont;
+
+  if(eConf.retrain == 0 or eConf.currentIter == 0){
+
+    if(!eConf.restore){
+      (*init)(pool, eConf);
+    } else {
+      pool.clear();
+      restorePopulationFromSnapshot(eConf.snapshot);
+    }
+  }else{
+    eConf.currentIter = 0;
+    rob->getFreeArea(true);
+    // The covered layer changed, recorded coverage is outdated
+    rob->invalidateCheckpoints();
+    fs->cache.clear();
+    // Magic with the logger to keep old performance data
+    eConf.logDir += "/retrain_run";
+  }
+  robots = RobotPool(rob, eConf.evalThreads);
+  // Children are compared with single evaluations (evaluateGen), the initial
+  // pool has to be on the same scale and does not get the pool bias
+  resetLoggingFitnessParameter(eConf);
+  vector<genome*> initial;
+  for(auto &gen : pool)
+    initial.push_back(&gen);
+  fs->estimateGens(initial, robots, eConf);
+  finalizeFitnessLogging(pool.size(), eConf);
+
+  // Population shared by the workers, pool is the snapshot used for logging
+  Genpool population = pool;
+  assertm(!population.empty(), "Steady state needs an initial population");
+  mutex popMtx, cacheMtx;
+  atomic<bool> stop(false);
+  atomic<int> matings(0), evaluations(0), hits(0), misses(0);
+
+  // Configuration and robot of each worker are copied before any thread starts,
+  // the main thread writes eConf and rob (visualization) while logging
+  int count = max(eConf.evalThreads, 1);
+  vector<executionConfig> confs(count, eConf);
+  vector<shared_ptr<Robot>> wrobs;
+  for(int w=0; w<count; w++){
+    seed_seq seed{eConf.genSeed, eConf.island, w};
+    confs[w].generator.seed(seed);
+    wrobs.push_back(rob->clone(make_shared<GridMap>(*rob->pmap)));
+  }
+
+  // Workers select, recombine, mutate, evaluate and insert without waiting for each other
+  vector<thread> workers;
+  for(int w=0; w<count; w++){
+    workers.emplace_back([&, conf = move(confs[w]), wrob = wrobs[w]]() mutable {
+      TournamentSelection select;
+      while(!stop){
+	genome par1, par2;
+	{
+	  lock_guard<mutex> lock(popMtx);
+	  par1 = population[select.tournamentIndex(population, conf)];
+	  par2 = population[select.tournamentIndex(population, conf)];
+	}
+	Genpool offspring;
+	if(!applyAction(conf.crossoverProba, conf) or !crossing->mating(par1, par2, offspring, conf))
+	  offspring.push_back(par1);
+
+	for(auto &child : offspring){
+	  bool mutated = mutate->randomReplaceGen(child, conf);
+	  if(not mutated){
+	    mutated |= mutate->addRandomAngleOffset(child, conf);
+	    mutated |= mutate->addOrthogonalAngleOffset(child, conf);
+	    mutated |= mutate->randomScaleDistance(child, conf);
+	  }
+	  child.mutated = mutated;
+
+	  bool cached;
+	  {
+	    lock_guard<mutex> lock(cacheMtx);
+	    cached = fs->restoreGen(child, conf);
+	  }
+	  if(!cached){
+	    fs->evaluateGen(child, *wrob, conf);
+	    lock_guard<mutex> lock(cacheMtx);
+	    fs->storeGen(child, conf);
+	  }
+	  hits += conf.cacheHits;
+	  misses += conf.cacheMisses;
+	  conf.cacheHits = conf.cacheMisses = 0;
+	  evaluations++;
+
+	  // Replace the worst gen if the child is better
+	  lock_guard<mutex> lock(popMtx);
+	  auto worst = min_element(population.begin(), population.end());
+	  if(*worst < child)
+	    *worst = std::move(child);
+	}
+	matings++;
+      }
+    });
+  }
+
+  auto start = high_resolution_clock::now();
+  int matingsPerIter = max(eConf.selectIndividuals, 1);
+  while(eConf.currentIter <= eConf.maxIterations){
+    {
+      lock_guard<mutex> lock(popMtx);
+      pool = population;
+    }
+    // Logging works on the snapshot, the workers continue
+    eConf.evaluations = evaluations;
+    eConf.evalRate = evaluations / duration<double>(high_resolution_clock::now() - start).count();
+    eConf.cacheHits = hits.exchange(0);
+    eConf.cacheMisses = misses.exchange(0);
+    eConf.deadGensCount = countDeadGens(pool, eConf.getMinGenLen(), eConf.mapResolution);
+    eConf.zeroActionPercent = calZeroActionPercent(pool, eConf.mapResolution);
+    trackDiversity(pool, diversity, eConf);
+    getBestGen(pool, eConf);
+    trackPoolFitness(pool, eConf);
+    logAndSnapshotPool(eConf);
+    printRunInformation(eConf, display);
+    if (checkEndCondition())
+      break;
+    if(migration){
+      lock_guard<mutex> lock(popMtx);
+      migration(population, eConf);
+    }
+
+    // An iteration lasts selectIndividuals matings
+    while(matings < (eConf.currentIter + 1) * matingsPerIter)
+      this_thread::sleep_for(chrono::milliseconds(1));
+    eConf.currentIter++;
+  }
+  stop = true;
+  for(auto &t : workers)
+    t.join();
+  pool = population;
+  // Log Fitnessvalues for all iterations
+  logging::Logger(eConf.logStr->str(), eConf.logDir, eConf.logName, true);
+}
+
+void op::Optimizer::optimize(bool display){
+  if(eConf.scenario == 0)  // elitist selection
+    optimizePath(display);
+  else if(eConf.scenario == 4)
+    optimizePath_SteadyState(display);
+  else
+    optimizePath_Turn_RWS(display);
+}
@@ -1,6 +1,7 @@
 #ifndef __OPTI_ADAPTER__
 #define __OPTI_ADAPTER__
 #include <chrono>
+#include <thread>
 
 #include <Eigen/Dense>
 #include <algorithm>
@@ -34,6 +35,14 @@ namespace op {
   void clearZeroPAs(Genpool& pool, executionConfig& eConf);
 
   void getBestGen(Genpool& pool, executionConfig& eConf);
+  // Exact or (diversitySketch > 0) approximated diversity of the pool
+  void trackDiversity(Genpool& pool, DiversityMatrix& divMat, executionConfig& eConf);
+  /*
+    Share the cores between Eigen's (OpenMP) matrix products and the
+    evaluation threads of all islands. Eigen's setting is global, call it
+    before the optimizers start.
+  */
+  void limitEigenThreads(const executionConfig& eConf);
 
 
   /////////////////////////////////////////////////////////////////////////////
@@ -45,6 +54,7 @@ namespace op {
   using std::chrono::duration_cast;
   using std::chrono::duration;
   using std::chrono::milliseconds;
+  using std::chrono::microseconds;
 
   struct Optimizer {
     executionConfig eConf;
@@ -54,9 +64,21 @@ namespace op {
     shared_ptr<SelectionStrategy> select;
     shared_ptr<InitStrategy> init;
     Genpool pool, sel, elite;
+    // Indices of the best gens in elite, ascending by fitness
+    vector<int> eliteBest;
     SelectionPool sPool;
     FamilyPool fPool;
     shared_ptr<Robot> rob;
+    RobotPool robots;
+    // Arena of the current generations (actionArena), its allocations at the
+    // last generation change and the generations since the last compaction
+    shared_ptr<ActionArena> arena;
+    size_t arenaAllocs = 0;
+    int arenaAge = 0;
+    // Distances of the pool kept across iterations (incrementalDiversity)
+    DiversityMatrix diversity;
+    // Exchange gens with other populations once per iteration (IslandModel)
+    function<void(Genpool&, executionConfig&)> migration;
     std::chrono::time_point<std::chrono::high_resolution_clock> tp;
 
     Optimizer(
@@ -79,9 +101,11 @@ namespace op {
 	  warn("Resolutions does not match!");
 	  exit(-1);
 	}
-	rob = make_shared<PolyRobot>(PolyRobot(eConf.rob_conf,
-				     eConf.gmap,
-				     eConf.obstacleName));}
+	auto poly = make_shared<PolyRobot>(PolyRobot(eConf.rob_conf,
+						     eConf.gmap,
+						     eConf.obstacleName));
+	poly->scanline = eConf.scanlineRaster;
+	rob = poly;}
       else{
 	if(eConf.mapResolution != eConf.Rob_width){
 	  warn("Resolutions does not match!");
@@ -90,6 +114,8 @@ namespace op {
 	rob = make_shared<Robot>(Robot(eConf.rob_conf,
 				     eConf.gmap,
 				     eConf.obstacleName));}
+      rob->incremental = eConf.incrementalEval;
+      rob->packLayers(eConf.packedLayers);
       tp = high_resolution_clock::now();
 
     }
@@ -103,14 +129,57 @@ namespace op {
     void printRunInformation(executionConfig& eConf, bool display);
     void optimizePath(bool display = false);
     void optimizePath_Turn_RWS(bool display = false);
+    /**
+     * @brief      Steady state GA without generations (scenario 4).
+     *
+     * @details    evalThreads workers repeatedly draw two parents by
+     *             tournament from the shared population, create and
+     *             evaluate the offspring and replace the worst gen if a
+     *             child is better. Nobody waits for a complete generation.
+     *             All gens are evaluated without the pool bias
+     *             (FitnessRotationBias), otherwise children and the initial
+     *             population would be compared on different scales.
+     *             The calling thread logs a snapshot of the population every
+     *             selectIndividuals matings (one iteration), including the
+     *             evaluations per second.
+     */
+    void optimizePath_SteadyState(bool display = false);
+    // Run the scenario selected by eConf.scenario
+    void optimize(bool display = false);
     void logAndSnapshotPool(executionConfig& eConf);
     void restorePopulationFromSnapshot(const string path);
     void snapshotPopulation(const string path);
     void snapshotPopulation(executionConfig& eConf);
-    void saveBest(Genpool& pool, executionConfig& eConf, bool sortPool=true);
+    // Copy the pool to elite and index its selectKeepBest best gens (eliteBest)
+    void saveBest(Genpool& pool, executionConfig& eConf);
     void replaceWithBest(Genpool& pool, executionConfig& eConf);
     void insertBest(Genpool& pool, executionConfig& eConf);
     void balancePopulation(Genpool& pool, executionConfig& eConf);
+    /**
+     * @brief      Crossover, mutation and evaluation of every family in fPool.
+     *
+     * @details    Each family is a task on the work stealing scheduler of
+     *             robots, executed with the robot and a copy of eConf of the
+     *             worker. Crossover and mutation draw from the streams of
+     *             the family index (executionConfig::stream), thus the result
+     *             does not depend on the number of threads. Parents of families
+     *             without crossover are appended to pool in family order.
+     */
+    void evolveFamilies(DualPointCrossover &crossing, FitnessStrategy &fs);
+    /**
+     * @brief      Compact the action arena between two generations.
+     *
+     * @details    The arena is kept as long as the live fraction of its
+     *             allocations is at least arenaCompactBelow and it is younger
+     *             than arenaCompactEvery generations. Otherwise the actions of
+     *             pool, sel, elite and eConf.best are copied into a new arena
+     *             that is installed on the calling thread, afterwards the old
+     *             arena is released as a whole.
+     *             Sets actionAllocs, actionRetained and compactTime of eConf.
+     */
+    void nextGeneration();
+    // Install the arena of the population on the calling thread until the scope ends
+    ActionArena::Scope arenaScope();
     bool checkEndCondition();
   };
 }
@@ -0,0 +1,91 @@
+#include "action_arena.h"
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+//                                ActionArena                                //
+///////////////////////////////////////////////////////////////////////////////
+
+atomic<uint64_t> path::ActionArena::nextId(1);
+atomic<int> path::ActionArena::instances(0);
+
+namespace {
+  thread_local path::ActionArena *active = nullptr;
+}
+
+path::ActionArena::ActionArena(size_t blockSize):id(nextId++), blockSize(blockSize){
+  instances++;
+}
+
+shared_ptr<path::ActionArena> path::ActionArena::create(size_t blockSize){
+  // Dropping the handle releases its reference, the arena is deleted with the last object
+  return shared_ptr<ActionArena>(new ActionArena(blockSize), [](ActionArena *arena){arena->release();});
+}
+
+void* path::ActionArena::Block::bump(size_t bytes, size_t align){
+  uintptr_t base = reinterpret_cast<uintptr_t>(mem.get());
+  uintptr_t addr = (base + used + align - 1) & ~(uintptr_t)(align - 1);
+  if(addr + bytes > base + size)
+    return nullptr;
+  used = addr + bytes - base;
+  allocs++;
+  return reinterpret_cast<void*>(addr);
+}
+
+void* path::ActionArena::allocate(size_t bytes, size_t align){
+  // Block of the calling thread, the id guards against blocks of other arenas
+  thread_local struct {uint64_t arena = 0; Block *block = nullptr;} cursor;
+  live.fetch_add(1, memory_order_relaxed);
+  if(cursor.arena == id){
+    if(void *mem = cursor.block->bump(bytes, align))
+      return mem;
+  }
+  Block *block;
+  {
+    lock_guard<mutex> lock(mtx);
+    blocks.emplace_back(max(blockSize, bytes + align));
+    block = &blocks.back();
+  }
+  // Objects that do not fit into a regular block get a block of their own
+  if(bytes + align <= blockSize)
+    cursor = {id, block};
+  return block->bump(bytes, align);
+}
+
+void path::ActionArena::release(){
+  if(live.fetch_sub(1, memory_order_acq_rel) == 1)
+    delete this;
+}
+
+size_t path::ActionArena::allocations() const{
+  lock_guard<mutex> lock(mtx);
+  size_t allocs = 0;
+  for(auto &block : blocks)
+    allocs += block.allocs;
+  return allocs;
+}
+
+size_t path::ActionArena::used() const{
+  lock_guard<mutex> lock(mtx);
+  size_t bytes = 0;
+  for(auto &block : blocks)
+    bytes += block.used;
+  return bytes;
+}
+
+size_t path::ActionArena::memory() const{
+  lock_guard<mutex> lock(mtx);
+  size_t bytes = 0;
+  for(auto &block : blocks)
+    bytes += block.size;
+  return bytes;
+}
+
+path::ActionArena* path::ActionArena::current(){
+  return active;
+}
+
+path::ActionArena* path::ActionArena::install(ActionArena *arena){
+  ActionArena *previous = active;
+  active = arena;
+  return previous;
+}
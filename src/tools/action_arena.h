@@ -0,0 +1,146 @@
+#ifndef ACTION_ARENA_H
+#define ACTION_ARENA_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace path {
+  using namespace std;
+
+  /////////////////////////////////////////////////////////////////////////////
+  //                               ActionArena                               //
+  /////////////////////////////////////////////////////////////////////////////
+
+  /**
+   * @brief      Bump allocator for the path actions of one generation.
+   *
+   * @details    Every thread bumps a pointer in a block of its own, the lock
+   *             is only taken to hand out a new block. Memory is never
+   *             returned individually: once a generation is replaced its
+   *             survivors are copied into the next arena (see
+   *             Optimizer::nextGeneration) and the old arena is released in
+   *             one step. An arena is deleted when its handle (create) is
+   *             dropped and no object allocated in it is alive anymore, so
+   *             actions that escaped the compaction never dangle.
+   */
+  class ActionArena {
+  public:
+    // Arena owned by the returned handle
+    static shared_ptr<ActionArena> create(size_t blockSize = 64 * 1024);
+    ActionArena(const ActionArena&) = delete;
+    ActionArena& operator=(const ActionArena&) = delete;
+
+    void* allocate(size_t bytes, size_t align);
+    // Called for every destroyed object of the arena
+    void release();
+
+    // Statistics are exact only while no thread allocates from the arena
+    size_t allocations() const;
+    // Bytes handed out / reserved by all blocks
+    size_t used() const;
+    size_t memory() const;
+    // Objects of the arena that are still alive
+    size_t objects() const {return live.load() - 1;}
+
+    // Arena used by newAction on the calling thread (nullptr: make_shared)
+    static ActionArena* current();
+    // Use arena on the calling thread, returns the previously used one
+    static ActionArena* install(ActionArena *arena);
+
+    // Installs an arena on the calling thread until the end of the scope
+    struct Scope {
+      Scope(ActionArena *arena):previous(install(arena)){}
+      ~Scope(){install(previous);}
+      Scope(const Scope&) = delete;
+      ActionArena *previous;
+    };
+
+    // Arenas that were not deleted yet
+    static atomic<int> instances;
+
+  private:
+    explicit ActionArena(size_t blockSize);
+    ~ActionArena(){instances--;}
+
+    struct Block {
+      Block(size_t size):mem(new char[size]), size(size){}
+      // Written only by the thread that bumps in the block
+      void* bump(size_t bytes, size_t align);
+      unique_ptr<char[]> mem;
+      size_t size;
+      size_t used = 0;
+      size_t allocs = 0;
+    };
+
+    const uint64_t id;
+    size_t blockSize;
+    // Alive objects plus one for the handle
+    atomic<size_t> live{1};
+    mutable mutex mtx;
+    // deque keeps the blocks in place
+    deque<Block> blocks;
+
+    static atomic<uint64_t> nextId;
+  };
+
+  /**
+   * @brief      Allocator that places the control block and the object of a
+   *             shared_ptr (or the buffer of a container) in an
+   *             ActionArena. Deallocation only counts.
+   *
+   * @details    Without an arena the heap is used. Containers that are
+   *             default constructed or copied use the arena of the calling
+   *             thread, so a copy made during the compaction moves into the
+   *             new arena together with its action.
+   */
+  template<typename T>
+  struct ArenaAllocator {
+    using value_type = T;
+    using propagate_on_container_move_assignment = true_type;
+    using propagate_on_container_swap = true_type;
+
+    ArenaAllocator():arena(ActionArena::current()){}
+    ArenaAllocator(ActionArena *arena):arena(arena){}
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other):arena(other.arena){}
+
+    ArenaAllocator select_on_container_copy_construction() const {return ArenaAllocator();}
+
+    T* allocate(size_t n){
+      if(!arena)
+	return allocator<T>().allocate(n);
+      return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T *p, size_t n){
+      if(!arena)
+	allocator<T>().deallocate(p, n);
+      else
+	arena->release();
+    }
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U> &other) const {return arena == other.arena;}
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U> &other) const {return arena != other.arena;}
+
+    ActionArena *arena;
+  };
+
+  /**
+   * @brief      Create an action in the arena of the calling thread.
+   *
+   * @details    Falls back to make_shared if no arena is installed.
+   */
+  template<typename T, typename... Args>
+  shared_ptr<T> newAction(Args&&... args){
+    ActionArena *arena = ActionArena::current();
+    if(!arena)
+      return make_shared<T>(forward<Args>(args)...);
+    return allocate_shared<T>(ArenaAllocator<T>(arena), forward<Args>(args)...);
+  }
+}
+
+#endif /* ACTION_ARENA_H */
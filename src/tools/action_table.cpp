@@ -0,0 +1,141 @@
+#include "action_table.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//                                ActionTable                                //
+///////////////////////////////////////////////////////////////////////////////
+
+path::ActionTable::ActionTable(const PAs &pas){
+  reserve(pas.size());
+  for(auto &pa : pas)
+    push_back(*pa);
+}
+
+void path::ActionTable::reserve(int n){
+  type.reserve(n);
+  angle.reserve(n);
+  distance.reserve(n);
+  start.reserve(n);
+  end.reserve(n);
+  counters.reserve(n);
+  modified.reserve(n);
+}
+
+void path::ActionTable::clear(){
+  type.clear();
+  angle.clear();
+  distance.clear();
+  start.clear();
+  end.clear();
+  counters.clear();
+  modified.clear();
+}
+
+namespace {
+  float param(const path::PathAction &pa, path::PAP key){
+    auto it = pa.mod_config.find(key);
+    return it != pa.mod_config.end() ? it->second : 0.0f;
+  }
+
+  int counter(const path::PathAction &pa, path::Counter key){
+    auto it = pa.c_config.find(key);
+    return it != pa.c_config.end() ? it->second : 0;
+  }
+}
+
+void path::ActionTable::push_back(const PathAction &pa){
+  push_back(pa.type, Position::Zero(), Position::Zero());
+  store(size() - 1, pa);
+}
+
+void path::ActionTable::store(int i, const PathAction &pa){
+  assertm(pa.wps.size() > 0, "Cannot store action without waypoints");
+  type[i] = pa.type;
+  angle[i] = param(pa, PAP::Angle);
+  distance[i] = param(pa, PAP::Distance);
+  start[i] = pa.wps.front();
+  end[i] = pa.wps.back();
+  // Ordered by the values of Counter
+  for(int c=0; c<4; c++)
+    counters[i][c] = counter(pa, static_cast<Counter>(c));
+  modified[i] = pa.modified;
+}
+
+void path::ActionTable::load(int i, PathAction &pa) const{
+  pa.type = type[i];
+  pa.mod_config[PAP::Angle] = angle[i];
+  pa.mod_config[PAP::Distance] = distance[i];
+  if(type[i] == PAT::Ahead or type[i] == PAT::CAhead){
+    pa.wps = {start[i], end[i]};
+  }else{
+    // Start and end actions only keep their first waypoint
+    pa.wps = {start[i]};
+    pa.endPoint = start[i];
+  }
+  for(int c=0; c<4; c++)
+    pa.c_config[static_cast<Counter>(c)] = counters[i][c];
+  pa.modified = modified[i];
+}
+
+void path::ActionTable::push_back(PAT t, Position s, Position e){
+  // Same parameter as PathAction::setConfigByWaypoints
+  float a = 0;
+  Position V = e - s;
+  float dist = V.norm();
+  if(!(dist > 0 && dirToAngle(V/dist, a)))
+    a = 0;
+  type.push_back(t);
+  angle.push_back(a);
+  distance.push_back(dist);
+  start.push_back(s);
+  end.push_back(e);
+  counters.push_back({0, 0, 0, 0});
+  modified.push_back(false);
+}
+
+void path::ActionTable::append(const ActionTable &table, int first, int last){
+  type.insert(type.end(), table.type.begin() + first, table.type.begin() + last);
+  angle.insert(angle.end(), table.angle.begin() + first, table.angle.begin() + last);
+  distance.insert(distance.end(), table.distance.begin() + first, table.distance.begin() + last);
+  start.insert(start.end(), table.start.begin() + first, table.start.begin() + last);
+  end.insert(end.end(), table.end.begin() + first, table.end.begin() + last);
+  counters.insert(counters.end(), table.counters.begin() + first, table.counters.begin() + last);
+  modified.insert(modified.end(), table.modified.begin() + first, table.modified.begin() + last);
+}
+
+path::PAs path::ActionTable::toActions() const{
+  PAs pas;
+  for(int i=0; i<size(); i++)
+    pas.push_back(action(i));
+  return pas;
+}
+
+std::shared_ptr<path::PathAction> path::ActionTable::action(int i) const{
+  shared_ptr<PathAction> pa;
+  switch(type[i]){
+  case PAT::Start:{
+    pa = newAction<StartAction>(StartAction(start[i]));
+    break;
+  }
+  case PAT::Ahead: case PAT::CAhead:{
+    pa = newAction<AheadAction>(AheadAction(type[i], {}));
+    break;
+  }
+  case PAT::End:{
+    pa = newAction<EndAction>(EndAction({start[i]}));
+    break;
+  }
+  default:{
+    assertm(false, "Unknown action type in table!");
+  }
+  }
+  load(i, *pa);
+  return pa;
+}
+
+size_t path::ActionTable::memory() const{
+  return type.capacity() * sizeof(PAT)
+    + (angle.capacity() + distance.capacity()) * sizeof(float)
+    + (start.capacity() + end.capacity()) * sizeof(Position)
+    + counters.capacity() * sizeof(array<int, 4>)
+    + modified.capacity() * sizeof(uint8_t);
+}
@@ -0,0 +1,67 @@
+#ifndef ACTION_TABLE_H
+#define ACTION_TABLE_H
+
+#include "path_tools.h"
+#include <array>
+
+namespace path {
+
+  /////////////////////////////////////////////////////////////////////////////
+  //                               ActionTable                               //
+  /////////////////////////////////////////////////////////////////////////////
+
+  /**
+   * @brief      Flat (struct of arrays) representation of an action sequence.
+   *
+   * @details    Row i holds type, parameters, first and last waypoint and
+   *             counters of the i-th action. The table does not allocate per
+   *             action and can be walked without pointer chasing.
+   *             Use ActionTable(pas) and toActions() to convert between the
+   *             table and the PathAction objects of a genome.
+   *             The table is the storage format of pa_serializer only:
+   *             genomes, evaluation and the GA operators keep the shared
+   *             PathAction objects, which carry the copy on write state and
+   *             the checkpoints of the incremental evaluation.
+   */
+  struct ActionTable {
+    ActionTable(){}
+    ActionTable(const PAs &pas);
+
+    int size() const {return type.size();}
+    void reserve(int n);
+    void clear();
+
+    // Append a single action / the rows [first, last) of table
+    void push_back(const PathAction &pa);
+    // Append an action that drives from s to e (parameter are derived from the waypoints)
+    void push_back(PAT t, Position s, Position e);
+    void append(const ActionTable &table, int first, int last);
+
+    /**
+     * @brief      Create the PathAction objects of the table.
+     *
+     * @details    Waypoints, counters and the modified flag are restored,
+     *             end actions only keep their first waypoint.
+     */
+    PAs toActions() const;
+    // PathAction of row i (see toActions)
+    shared_ptr<PathAction> action(int i) const;
+
+    // Overwrite pa with the content of row i / row i with the content of pa
+    void load(int i, PathAction &pa) const;
+    void store(int i, const PathAction &pa);
+
+    // Approximate heap memory of the table [byte]
+    size_t memory() const;
+
+    vector<PAT> type;
+    vector<float> angle;
+    vector<float> distance;
+    vector<Position> start;
+    vector<Position> end;
+    vector<array<int, 4>> counters;
+    vector<uint8_t> modified;
+  };
+}
+
+#endif /* ACTION_TABLE_H */
@@ -36,6 +36,44 @@ bool conf::executionConfig::loadConfFromYaml(const string path){
     fitSselect = yConf["fitSselect"].as<float>();
   if(yConf["funSelect"])
     funSelect = yConf["funSelect"].as<float>();
+  if(yConf["evalThreads"])
+    evalThreads = yConf["evalThreads"].as<int>();
+  if(yConf["incrementalEval"])
+    incrementalEval = yConf["incrementalEval"].as<bool>();
+  if(yConf["scanlineRaster"])
+    scanlineRaster = yConf["scanlineRaster"].as<bool>();
+  if(yConf["packedLayers"])
+    packedLayers = yConf["packedLayers"].as<bool>();
+  if(yConf["fitnessCacheSize"])
+    fitnessCacheSize = yConf["fitnessCacheSize"].as<int>();
+  if(yConf["actionArena"])
+    actionArena = yConf["actionArena"].as<bool>();
+  if(yConf["arenaCompactBelow"])
+    arenaCompactBelow = yConf["arenaCompactBelow"].as<float>();
+  if(yConf["arenaCompactEvery"])
+    arenaCompactEvery = yConf["arenaCompactEvery"].as<int>();
+  if(yConf["keepPathMatrix"])
+    keepPathMatrix = yConf["keepPathMatrix"].as<bool>();
+  if(yConf["keepTrail"])
+    keepTrail = yConf["keepTrail"].as<bool>();
+  if(yConf["diversitySketch"])
+    diversitySketch = yConf["diversitySketch"].as<int>();
+  if(yConf["diversitySamples"])
+    diversitySamples = yConf["diversitySamples"].as<int>();
+  if(yConf["incrementalDiversity"])
+    incrementalDiversity = yConf["incrementalDiversity"].as<bool>();
+  if(yConf["islands"])
+    islands = yConf["islands"].as<int>();
+  if(yConf["migrationInterval"])
+    migrationInterval = yConf["migrationInterval"].as<int>();
+  if(yConf["migrationSize"])
+    migrationSize = yConf["migrationSize"].as<int>();
+  if(yConf["migrationTopology"])
+    migrationTopology = yConf["migrationTopology"].as<int>();
+  if(yConf["islandProcesses"])
+    islandProcesses = yConf["islandProcesses"].as<bool>();
+  if(yConf["pinNuma"])
+    pinNuma = yConf["pinNuma"].as<bool>();
   if(yConf["weights"]["time"])
     fitnessWeights[0] = yConf["weights"]["time"].as<float>();
   if(yConf["weights"]["occ"])
@@ -52,6 +90,8 @@ bool conf::executionConfig::loadConfFromYaml(const string path){
     selectIndividuals = yConf["select"].as<float>();
   if(yConf["selPressure"])
     selPressure = yConf["selPressure"].as<float>();
+  if(yConf["selectSUS"])
+    selectSUS = yConf["selectSUS"].as<bool>();
   if(yConf["tournamentSize"])
     tournamentSize = yConf["tournamentSize"].as<float>();
   if(yConf["crossoverProba"])
@@ -4,6 +4,7 @@
 #include "path_tools.h"
 #include "genome_tools.h"
 #include "mapGen.h"
+#include "philox.h"
 #include <limits>
 #define MIN_CROSS_LEN 4
 using namespace genome_tools;
@@ -63,6 +64,44 @@ namespace conf {
     bool penalizeZeroActions = true;
     int fitSselect = 1;
     int funSelect = 0;
+    // Threads (each with its own robot and map copy) used for fitness evaluation
+    int evalThreads = 1;
+    // Reuse the coverage of unchanged action prefixes
+    bool incrementalEval = true;
+    // Rasterize PolyRobot moves column wise instead of using the PolygonIterator
+    bool scanlineRaster = true;
+    // Bit packed obstacle and covered layers for collision tests
+    bool packedLayers = true;
+    // Number of evaluations kept in the fitness cache (0 disables the cache)
+    int fitnessCacheSize = 1000;
+    // Bump allocate the actions of each generation from one arena
+    bool actionArena = true;
+    // Compact the arena if less than this fraction of its allocations is alive
+    float arenaCompactBelow = 0.5;
+    // Compact at least every n generations (0: only by arenaCompactBelow)
+    int arenaCompactEvery = 0;
+    // Keep a dense copy of the coverage per gen (diversity uses the sparse signature)
+    bool keepPathMatrix = false;
+    // Store the coverage layer of replaced gens in genome::trail
+    bool keepTrail = false;
+    // Estimate the diversity from random projections of this length (0: exact)
+    int diversitySketch = 0;
+    // Partners per gen for the estimation (0: all gens)
+    int diversitySamples = 0;
+    // Keep the pairwise distances across iterations, only new gens are compared
+    bool incrementalDiversity = true;
+    // Sub-populations on separate threads (> 1 enables the island model)
+    int islands = 1;
+    // Iterations between two migrations
+    int migrationInterval = 10;
+    // Best gens sent per migration
+    int migrationSize = 2;
+    // 0: ring, 1: random target islands
+    int migrationTopology = 0;
+    // Run the islands as processes that communicate over shared memory
+    bool islandProcesses = false;
+    // Pin island processes to the NUMA nodes (round robin)
+    bool pinNuma = true;
 
     // Snapshots
     bool restore = false;
@@ -88,6 +127,8 @@ namespace conf {
     float diversityStd = 0;
     float diversityMin = 0;
     float diversityMax = 0;
+    // Mean relative error of the approximated distances
+    float diversityError = 0;
 
     // Population
     int popSelected = 0;
@@ -116,6 +157,20 @@ namespace conf {
     float fitnessAvgObjCount = 0;
     float fitnessMinObjCount = 0;
     float fitnessMaxObjCount = 0;
+    // Evaluations restored from / missed in the fitness cache during the last iteration
+    int cacheHits = 0;
+    int cacheMisses = 0;
+    // Arena allocations (actions and waypoints) during the last generation,
+    // bytes used by the arena and duration of the last compaction [us]
+    int actionAllocs = 0;
+    size_t actionRetained = 0;
+    long compactTime = 0;
+    // Index of the island and gens it received in the last iteration
+    int island = 0;
+    int migrants = 0;
+    // Offspring evaluated so far and per second (steady state scenario)
+    int evaluations = 0;
+    float evalRate = 0;
 
     shared_ptr<std::ostringstream> fitnessStr;
     shared_ptr<std::ostringstream> logStr;
@@ -130,7 +185,17 @@ namespace conf {
     rob_config rob_conf;
 
     // Map
-    std::mt19937 generator;
+    rng::Philox generator;
+    /**
+     * @brief      Draw from the random stream of op and individual in the current iteration.
+     *
+     * @details    The generator jumps to the start of the stream keyed by
+     *             (currentIter, individual, op). The numbers an operator
+     *             draws do not depend on how many numbers were drawn before.
+     */
+    void stream(rng::Op op, int individual = 0){
+      generator.stream(currentIter, individual, static_cast<uint32_t>(op));
+    }
     int mapType = 1;
     int mapWidth = 11;
     int mapHeight = 11;
@@ -155,6 +220,8 @@ namespace conf {
     int selectKeepBest = 0;
     int tournamentSize = 2;
     float selPressure = 1.5;
+    // Stochastic universal sampling for (ranked) roulette wheel selection
+    bool selectSUS = false;
     genome best;
     // Switch between roulettWheelSelection or best N selection
     bool toggleRoulettSelectionOn = false;
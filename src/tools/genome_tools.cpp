@@ -1,6 +1,6 @@
 #include "genome_tools.h"
 
-int genome_tools::genome::gen_id = 0;
+atomic<int> genome_tools::genome::gen_id(0);
 
 // float calVectorAngle(Position a, Position b){
 //   float dot = a.dot(b);
@@ -84,8 +84,147 @@ bool genome_tools::genome::updateGenParameter(){
   return pathLengh > 0;
 }
 
-void genome_tools::genome::setPathSignature(shared_ptr<GridMap> gmap){
-  mat = make_shared<Matrix>(Matrix(gmap->get("map")));
+void genome_tools::genome::setPathSignature(path::Robot &rob, bool keepMatrix, int sketchSize){
+  const Matrix &layer = (*rob.pmap)[rob.opName];
+  auto sig = make_shared<PathSignature>(layer, rob.touched);
+  if(sketchSize > 0)
+    sig->project(sketchSize);
+  signature = sig;
+  if(keepMatrix){
+    rob.syncCoverage();
+    mat = make_shared<Matrix>(layer);
+  }else
+    mat.reset();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                               PathSignature                               //
+///////////////////////////////////////////////////////////////////////////////
+
+genome_tools::PathSignature::PathSignature(const Matrix &layer):
+  rows(layer.rows()), cols(layer.cols()){
+  const float *data = layer.data();
+  for(int i=0; i<layer.size(); i++){
+    if(data[i] != 0){
+      cells.push_back(i);
+      values.push_back(data[i]);
+    }
+  }
+  cells.shrink_to_fit();
+  values.shrink_to_fit();
+}
+
+genome_tools::PathSignature::PathSignature(const Matrix &layer, const vector<int> &candidates):
+  rows(layer.rows()), cols(layer.cols()), cells(candidates){
+  sort(cells.begin(), cells.end());
+  cells.erase(unique(cells.begin(), cells.end()), cells.end());
+  const float *data = layer.data();
+  // Cells can drop back to zero (e.g. restored prefix)
+  cells.erase(remove_if(cells.begin(), cells.end(), [data](int c){return data[c] == 0;}), cells.end());
+  cells.shrink_to_fit();
+  values.reserve(cells.size());
+  for(int c : cells)
+    values.push_back(data[c]);
+}
+
+float genome_tools::PathSignature::distance(const PathSignature &other) const{
+  // Merge the sorted cell lists
+  double sum = 0;
+  int i = 0, j = 0;
+  while(i < cells.size() and j < other.cells.size()){
+    if(cells[i] == other.cells[j]){
+      float diff = values[i++] - other.values[j++];
+      sum += diff * diff;
+    }else if(cells[i] < other.cells[j]){
+      sum += values[i] * values[i];
+      i++;
+    }else{
+      sum += other.values[j] * other.values[j];
+      j++;
+    }
+  }
+  for(; i < cells.size(); i++)
+    sum += values[i] * values[i];
+  for(; j < other.cells.size(); j++)
+    sum += other.values[j] * other.values[j];
+  return sqrt(sum);
+}
+
+void genome_tools::PathSignature::project(int size){
+  // splitmix64, a fixed seed keeps the projection equal for all gens
+  auto mix = [](uint64_t x){
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  };
+  int words = (size + 63) / 64;
+  float scale = 1 / sqrt(static_cast<float>(size));
+  sketch.assign(size, 0);
+  for(int i=0; i<cells.size(); i++){
+    float val = values[i] * scale;
+    for(int w=0; w<words; w++){
+      uint64_t bits = mix(static_cast<uint64_t>(cells[i]) * words + w);
+      for(int b=0; b<64 and w*64 + b < size; b++)
+	sketch[w*64 + b] += (bits >> b) & 1 ? val : -val;
+    }
+  }
+}
+
+Matrix genome_tools::PathSignature::toMatrix() const{
+  Matrix layer = Matrix::Zero(rows, cols);
+  for(int i=0; i<cells.size(); i++)
+    layer.data()[cells[i]] = values[i];
+  return layer;
+}
+
+void genome_tools::genome::detach(PAs::iterator it){
+  if(it->use_count() > 1)
+    *it = (*it)->clone();
+}
+
+void genome_tools::genome::detach(){
+  for(auto it = actions.begin(); it != actions.end(); ++it)
+    detach(it);
+}
+
+size_t genome_tools::genome::structuralHash(float quantum) const{
+  size_t h = 14695981039346656037ULL;
+  auto mix = [&h](int64_t val){
+    h ^= std::hash<int64_t>{}(val) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+  };
+  for(auto &pa : actions){
+    mix(static_cast<int>(pa->type));
+    for(auto &wp : pa->wps){
+      mix(llround(wp.x() / quantum));
+      mix(llround(wp.y() / quantum));
+    }
+    for(auto &counter : pa->c_config)
+      mix(counter.second);
+  }
+  return h;
+}
+
+genome_tools::PoolMembers::PoolMembers(Genpool &pool, size_t expected):pool(pool){
+  reserve(max(expected, pool.size()));
+  for(auto &gen : pool)
+    ids.insert(gen.id);
+}
+
+void genome_tools::PoolMembers::reserve(size_t expected){
+  ids.reserve(expected);
+}
+
+void genome_tools::PoolMembers::track(const Genpool &gens){
+  for(auto &gen : gens)
+    ids.insert(gen.id);
+}
+
+bool genome_tools::PoolMembers::insert(const genome &gen){
+  if(!ids.insert(gen.id).second)
+    return false;
+  pool.push_back(gen);
+  return true;
 }
 
 void genome_tools::validateGen(genome &gen){
@@ -110,6 +249,7 @@ void genome_tools::validateGen(genome &gen){
    assertm(!((*it)->modified && ((*it)->type == PAT::End)), "Not allowed!, End points cannot be modified!");
 
 
+    gen.detach(it);
     (*it)->applyModifications();
     // Change the configuration of the consecutive action
     // Propagate changes until properly applied
@@ -117,6 +257,7 @@ void genome_tools::validateGen(genome &gen){
     auto it_current = it;
     auto it_next = next(it, 1);
     // debug("Type: ", int((*it_next)->type));
+    gen.detach(it_next);
     while(!(*it_next)->mendConfig(*it_current)){
       // assertm(!((*it_current)->modified && ((*it)->type == PAT::Start)), "Not allowed!, Start points cannot be modified!");
       assertm(!((*it_next)->modified && ((*it)->type == PAT::End)), "Not allowed!, End points cannot be modified!");
@@ -127,6 +268,7 @@ void genome_tools::validateGen(genome &gen){
       it_next++;
       // TODO: goto end or just return because all changes had been applied
       if(it_next == gen.actions.end()) return;
+      gen.detach(it_next);
     }
   }
 }
@@ -198,65 +340,284 @@ void genome_tools::removeZeroPAs(genome &gen, float delta){
   // gen.actions =
 }
 
+vector<int> genome_tools::fitnessOrder(const Genpool &pool){
+  vector<int> order(pool.size());
+  iota(order.begin(), order.end(), 0);
+  sort(order.begin(), order.end(), [&pool](int a, int b){return pool[a] < pool[b];});
+  return order;
+}
+
+vector<int> genome_tools::topK(const Genpool &pool, int k){
+  k = min<int>(max(k, 0), pool.size());
+  vector<int> order(pool.size());
+  iota(order.begin(), order.end(), 0);
+  partial_sort(order.begin(), order.begin() + k, order.end(), [&pool](int a, int b){return pool[b] < pool[a];});
+  order.resize(k);
+  reverse(order.begin(), order.end());
+  return order;
+}
+
+vector<int> genome_tools::bottomK(const Genpool &pool, int k){
+  k = min<int>(max(k, 0), pool.size());
+  vector<int> order(pool.size());
+  iota(order.begin(), order.end(), 0);
+  partial_sort(order.begin(), order.begin() + k, order.end(), [&pool](int a, int b){return pool[a] < pool[b];});
+  order.resize(k);
+  return order;
+}
+
+Eigen::MatrixXd genome_tools::pairwiseDistances(const Genpool &pool){
+  int pSize = pool.size();
+  const PathSignature empty;
+  vector<const PathSignature*> sigs;
+  size_t nnz = 0;
+  for(auto &gen : pool){
+    sigs.push_back(gen.signature ? gen.signature.get() : &empty);
+    nnz += sigs.back()->cells.size();
+  }
+
+  // Rows of the product: cells visited by any gen
+  vector<int> cells;
+  cells.reserve(nnz);
+  for(auto sig : sigs)
+    cells.insert(cells.end(), sig->cells.begin(), sig->cells.end());
+  sort(cells.begin(), cells.end());
+  cells.erase(unique(cells.begin(), cells.end()), cells.end());
+  auto row = [&cells](int cell){
+    return lower_bound(cells.begin(), cells.end(), cell) - cells.begin();
+  };
+
+  // Gram matrix G(i,j) = a_i * a_j
+  Eigen::MatrixXd G = Eigen::MatrixXd::Zero(pSize, pSize);
+  if(cells.size() > 0 and nnz < 0.1 * cells.size() * pSize){
+    vector<Eigen::Triplet<double>> triplets;
+    triplets.reserve(nnz);
+    for(int col=0; col<pSize; col++)
+      for(int i=0; i<sigs[col]->cells.size(); i++)
+	triplets.emplace_back(row(sigs[col]->cells[i]), col, sigs[col]->values[i]);
+    Eigen::SparseMatrix<double> S(cells.size(), pSize);
+    S.setFromTriplets(triplets.begin(), triplets.end());
+    G = Eigen::SparseMatrix<double>(S.transpose() * S);
+  }else if(cells.size() > 0){
+    // Dense blocks of cells, each product is a (multithreaded) GEMM
+    const int blockRows = 4096;
+    vector<int> pos(pSize, 0);
+    Eigen::MatrixXd S(min<int>(blockRows, cells.size()), pSize);
+    for(int first=0; first<cells.size(); first+=blockRows){
+      int rows = min<int>(blockRows, cells.size() - first);
+      S.setZero();
+      for(int col=0; col<pSize; col++){
+	auto &sig = *sigs[col];
+	// Signatures are sorted, continue where the last block stopped
+	for(int &i = pos[col]; i<sig.cells.size(); i++){
+	  int r = row(sig.cells[i]) - first;
+	  if(r >= rows)
+	    break;
+	  S(r, col) = sig.values[i];
+	}
+      }
+      G.noalias() += S.topRows(rows).transpose() * S.topRows(rows);
+    }
+  }
+
+  Eigen::VectorXd norms = G.diagonal();
+  Eigen::MatrixXd D = ((norms.replicate(1, pSize) + norms.transpose().replicate(pSize, 1)) - 2 * G)
+    .cwiseMax(0).cwiseSqrt();
+  D.diagonal().setZero();
+  return D;
+}
+
 void genome_tools::calDistanceMat(Genpool &pool, Eigen::VectorXf& upperFlat){
+  // upperFlat holds the summed distance of each gen to all others
+  Eigen::VectorXd sums = pairwiseDistances(pool).rowwise().sum();
+  upperFlat.head(pool.size()) += sums.cast<float>();
+  for(int i=0; i<pool.size(); i++)
+    pool[i].diversityFactor = sums[i];
+}
+
+
+void genome_tools::calDistanceSketch(Genpool &pool, Eigen::VectorXf& upperFlat, int samples, rng::Philox &generator, float &error){
   int pSize = pool.size();
-  // assert(D.cols() == pSize);
-  // assert(D.rows() == pSize);
-  // assert(pSize*(pSize +1)/2 == upperFlat.size());
-  for (auto it = pool.begin(); it != pool.end(); ++it) {
-    it->diversityFactor = 0;
+  int size = 0;
+  for(auto &gen : pool)
+    if(gen.signature)
+      size = max<int>(size, gen.signature->sketch.size());
+  // Sketches as columns, missing ones stay zero
+  Eigen::MatrixXf S = Eigen::MatrixXf::Zero(size, pSize);
+  for(int i=0; i<pSize; i++){
+    auto &sig = pool[i].signature;
+    if(sig and sig->sketch.size() == size)
+      S.col(i) = Eigen::Map<const Eigen::VectorXf>(sig->sketch.data(), size);
   }
-  int idx = 0;
-  for(int row=0; row < pSize-1; row++){
-    // pool[row].diversityFactor = 0;
-    for(int col=row+1; col<pSize; col++){
-      // TODO: Only possible pixel
-      float res = (*pool[row].mat - *pool[col].mat).norm();
-      // debug("Row: ", row, " Col: ", col, " dist: ", res);
-      // assert(res == (*pool[col].mat -*pool[row].mat).norm());
-      upperFlat[row] += res;
-      upperFlat[col] += res;
-      pool[row].diversityFactor += res;
-      pool[col].diversityFactor += res;
-      idx++;
+
+  vector<pair<int, int>> checked;
+  Eigen::VectorXf sums = Eigen::VectorXf::Zero(pSize);
+  if(samples <= 0 or samples >= pSize - 1){
+    Eigen::MatrixXf G = S.transpose() * S;
+    Eigen::VectorXf norms = G.diagonal();
+    for(int i=0; i<pSize; i++)
+      for(int j=0; j<pSize; j++)
+	if(i != j)
+	  sums[i] += sqrt(max(0.0f, norms[i] + norms[j] - 2 * G(i, j)));
+    uniform_int_distribution<int> gens(0, max(0, pSize-1));
+    for(int c=0; c<32 and pSize > 1; c++){
+      int i = gens(generator), j = gens(generator);
+      if(i != j)
+	checked.push_back({i, j});
+    }
+  }else{
+    uniform_int_distribution<int> partner(0, pSize-2);
+    for(int i=0; i<pSize; i++){
+      for(int s=0; s<samples; s++){
+	int j = partner(generator);
+	// Skip the gen itself
+	j += j >= i;
+	sums[i] += (S.col(i) - S.col(j)).norm();
+	if(checked.size() < 32)
+	  checked.push_back({i, j});
+      }
+      sums[i] *= static_cast<float>(pSize-1) / samples;
     }
   }
 
+  // Compare the estimation to the exact distance
+  const PathSignature empty;
+  auto sig = [&pool, &empty](int i) -> const PathSignature& {
+    return pool[i].signature ? *pool[i].signature : empty;
+  };
+  error = 0;
+  int count = 0;
+  for(auto &[i, j] : checked){
+    float exact = sig(i).distance(sig(j));
+    if(exact > 0){
+      error += abs((S.col(i) - S.col(j)).norm() - exact) / exact;
+      count++;
+    }
+  }
+  error = count > 0 ? error / count : 0;
+
+  upperFlat.head(pSize) += sums;
+  for(int i=0; i<pSize; i++)
+    pool[i].diversityFactor = sums[i];
 }
 
+// Statistics of the summed distances of each gen
+static void divStats(const Eigen::VectorXf &upperFlat, float& mean, float& stdev, float &min_, float &max_){
+  mean = upperFlat.mean();
+  min_ = upperFlat.minCoeff();
+  max_ = upperFlat.maxCoeff();
+  stdev = sqrt((upperFlat.array() - mean).square().sum()/(upperFlat.size()-1));
+}
+
+void genome_tools::getDivMeanStd(Genpool &pool, float& mean, float& stdev, float &min_, float &max_,
+				 int samples, rng::Philox &generator, float &error){
+  Eigen::VectorXf upperFlat = Eigen::VectorXf::Zero(pool.size());
+  calDistanceSketch(pool, upperFlat, samples, generator, error);
+  divStats(upperFlat, mean, stdev, min_, max_);
+}
 
 void genome_tools::getDivMeanStd(Genpool &pool, float& mean, float& stdev, float &min_, float &max_){
   int pSize = pool.size();
   // Eigen::MatrixXf D(pSize, pSize);
   Eigen::VectorXf upperFlat(pSize);
-  // debug("..", upperFlat);
   upperFlat.setZero();
-  // debug("..", upperFlat);
   calDistanceMat(pool, upperFlat);
+  divStats(upperFlat, mean, stdev, min_, max_);
+  // std = D.triangularView<Eigen::Upper>().std();
+}
 
-  // Eigen::VectorXi minIdx;
-  mean = upperFlat.mean();
-  min_ = upperFlat.minCoeff();
-  max_ = upperFlat.maxCoeff();
+///////////////////////////////////////////////////////////////////////////////
+//                              DiversityMatrix                              //
+///////////////////////////////////////////////////////////////////////////////
 
-  // debug("Min: ", min_);
-  // debug("Max: ", max_);
-  // debug("Mean: ", mean);
+void genome_tools::DiversityMatrix::clear(){
+  slots.clear();
+  sigs.clear();
+  counts.clear();
+  freeSlots.clear();
+  D.resize(0, 0);
+  sums.resize(0);
+}
 
-  // debug("Size: ", pSize);
-  // debug("Start");
-  // for(int i=0; i<pSize-1; i++){
-  //   for(int j=i+1; j<pSize; j++){
-  //     cout << D(j,i) << "|";
-  //   }
-  //   cout << endl;
-  // }
-  // debug("Min: ", min_, " Max: ", max_);
+int genome_tools::DiversityMatrix::addSlot(shared_ptr<const PathSignature> sig){
+  if(freeSlots.empty()){
+    int cap = sigs.size();
+    int newCap = max(16, 2 * cap);
+    D.conservativeResize(newCap, newCap);
+    D.rightCols(newCap - cap).setZero();
+    D.bottomRows(newCap - cap).setZero();
+    sums.conservativeResize(newCap);
+    sums.tail(newCap - cap).setZero();
+    sigs.resize(newCap);
+    counts.resize(newCap, 0);
+    for(int i=newCap-1; i>=cap; i--)
+      freeSlots.push_back(i);
+  }
+  int slot = freeSlots.back();
+  freeSlots.pop_back();
+  slots[sig.get()] = slot;
+  sigs[slot] = sig;
+  counts[slot] = 0;
+  sums[slot] = 0;
+  // The row of the new path, the sum follows with adjustCount
+  for(auto &[ptr, other] : slots){
+    if(other == slot)
+      continue;
+    D(slot, other) = D(other, slot) = sig->distance(*sigs[other]);
+    sums[slot] += counts[other] * D(slot, other);
+  }
+  computedRows++;
+  return slot;
+}
 
-  // debug(upperFlat);
-  // debug("End ---");
-  // debug(D);
-  stdev = sqrt((upperFlat.array() - mean).square().sum()/(upperFlat.size()-1));
+void genome_tools::DiversityMatrix::adjustCount(int slot, int count){
+  int delta = count - counts[slot];
+  if(delta == 0)
+    return;
+  for(auto &[ptr, other] : slots)
+    sums[other] += delta * D(other, slot);
+  counts[slot] = count;
+}
 
-  // std = D.triangularView<Eigen::Upper>().std();
+void genome_tools::DiversityMatrix::update(Genpool &pool, Eigen::VectorXf& upperFlat){
+  static const auto empty = make_shared<const PathSignature>();
+  computedRows = 0;
+  // Copies of a gen share the signature of their evaluation
+  unordered_map<const PathSignature*, int> current;
+  vector<shared_ptr<const PathSignature>> poolSigs;
+  for(auto &gen : pool){
+    poolSigs.push_back(gen.signature ? gen.signature : empty);
+    current[poolSigs.back().get()]++;
+  }
+
+  // Drop paths that left the pool
+  for(auto it = slots.begin(); it != slots.end();){
+    if(current.count(it->first) == 0){
+      int slot = it->second;
+      adjustCount(slot, 0);
+      sigs[slot].reset();
+      freeSlots.push_back(slot);
+      it = slots.erase(it);
+    }else{
+      it++;
+    }
+  }
+  // Add new paths and update the multiplicities
+  for(auto &sig : poolSigs){
+    auto it = slots.find(sig.get());
+    int slot = it != slots.end() ? it->second : addSlot(sig);
+    adjustCount(slot, current[sig.get()]);
+  }
+
+  for(int i=0; i<pool.size(); i++){
+    float sum = sums[slots[poolSigs[i].get()]];
+    upperFlat[i] += sum;
+    pool[i].diversityFactor = sum;
+  }
+}
+
+void genome_tools::getDivMeanStd(Genpool &pool, DiversityMatrix &divMat, float& mean, float& stdev, float &min_, float &max_){
+  Eigen::VectorXf upperFlat = Eigen::VectorXf::Zero(pool.size());
+  divMat.update(pool, upperFlat);
+  divStats(upperFlat, mean, stdev, min_, max_);
 }
@@ -3,19 +3,63 @@
 
 #include "path_tools.h"
 #include "debug.h"
+#include "philox.h"
+#include <Eigen/Sparse>
+#include <unordered_map>
+#include <unordered_set>
+#include <numeric>
 
 using namespace std;
 using namespace grid_map;
 using namespace path;
 
 namespace genome_tools {
+
+  /**
+   * @brief      Sparse coverage of a path (visited cells and their counts).
+   *
+   * @details    Replaces the copy of the whole coverage layer per gen.
+   *             Cells are stored as sorted linear (column major) indices,
+   *             distance() equals the norm of the difference of the layers.
+   */
+  struct PathSignature {
+    PathSignature(){}
+    // Scan the whole layer (tests, dense matrices)
+    PathSignature(const Matrix &layer);
+    // Read only the given cells (any order, duplicates allowed) of the layer
+    PathSignature(const Matrix &layer, const vector<int> &candidates);
+
+    float distance(const PathSignature &other) const;
+    // Dense coverage layer, e.g. for visualization
+    Matrix toMatrix() const;
+    size_t memory() const {return (cells.capacity() + values.capacity() + sketch.capacity()) * 4;}
+
+    /**
+     * @brief      Random projection of the coverage to size values.
+     *
+     * @details    The projection matrix holds +-1/sqrt(size) entries that are
+     *             derived from a hash of the cell, hence all gens share it
+     *             without storing it. The distance of two sketches estimates
+     *             distance() (Johnson-Lindenstrauss).
+     */
+    void project(int size);
+
+    int rows = 0;
+    int cols = 0;
+    vector<int> cells;
+    vector<float> values;
+    vector<float> sketch;
+  };
+
   struct genome{
 
-    static int gen_id;
+    // Shared by all threads that create gens
+    static atomic<int> gen_id;
+    // Coverage layer of the last execution, only set if requested (keepTrail)
     grid_map::Matrix trail;
-    genome():id(gen_id){gen_id++;};
-    genome(float fitness):fitness(fitness),id(gen_id){gen_id++;};
-    genome(PAs actions):actions(actions),id(gen_id){gen_id++;};
+    genome():id(gen_id++){};
+    genome(float fitness):fitness(fitness),id(gen_id++){};
+    genome(PAs actions):actions(actions),id(gen_id++){};
     bool operator < (const genome& gen) const
     {
         return (fitness < gen.fitness);
@@ -41,7 +85,37 @@ namespace genome_tools {
        Returns false if distance is 0 -> gen fitness does not need to be calculated
      */
     bool updateGenParameter();
-    void setPathSignature(shared_ptr<GridMap> gmap);
+    /**
+     * @brief      Store the coverage of the last execution of rob.
+     *
+     * @details    Only the cells rob touched in the current coverage epoch
+     *             are read, the layer is synchronized only for keepMatrix.
+     *
+     * @param      keepMatrix additionally keep a dense copy in mat
+     * @param      sketchSize length of the random projection (0: none)
+     */
+    void setPathSignature(path::Robot &rob, bool keepMatrix=false, int sketchSize=0);
+
+    /**
+     * @brief      Hash of the action sequence.
+     *
+     * @details    Covers the action types, the waypoints (quantized by
+     *             quantum [m]) and the counters of the last execution.
+     *             Gens with equal hash yield the same evaluation.
+     */
+    size_t structuralHash(float quantum=1e-4) const;
+
+    /**
+     * @brief      Copy on write for the actions of the gen.
+     *
+     * @details    Copies of a genome share their PathAction objects, copying
+     *             a gen only copies the pointers. Every action has to be
+     *             detached before it is changed: if it is referenced by
+     *             another gen it is replaced by a private clone.
+     *             Without argument all shared actions are detached.
+     */
+    void detach(PAs::iterator it);
+    void detach();
 
 
 
@@ -70,6 +144,8 @@ namespace genome_tools {
     bool crossed = false;
     bool mutated = false;
     bool selected = false;
+    shared_ptr<const PathSignature> signature;
+    // Dense copy of the coverage, only set if requested (keepPathMatrix)
     shared_ptr<Matrix> mat;
   };
 
@@ -78,6 +154,29 @@ namespace genome_tools {
   using SelectionPool = list<GenPair>;
   using FamilyPool = deque<Genpool>;
 
+  /**
+   * @brief      Builds a pool without duplicate gens (same id).
+   *
+   * @details    Tracks the ids of the pool in a hash set, insert is O(1)
+   *             instead of a search over the pool. Gens that are appended
+   *             directly (new children) have unused ids and need no
+   *             registration. The id table is allocated once for the
+   *             expected number of gens of the generation.
+   */
+  struct PoolMembers {
+    PoolMembers(Genpool &pool, size_t expected=0);
+    // Reserve the table for expected gens
+    void reserve(size_t expected);
+    // Register gens that belong to the generation but are kept in another pool
+    void track(const Genpool &gens);
+    // Append gen if its id is not yet part of the pool, returns true if appended
+    bool insert(const genome &gen);
+    bool contains(const genome &gen) const {return ids.count(gen.id) > 0;}
+
+    Genpool &pool;
+    unordered_set<int> ids;
+  };
+
   /**
    * @brief      If a gen is modified apply the changes to the consecutive actions
    *
@@ -97,8 +196,80 @@ namespace genome_tools {
   int countDeadGens(Genpool &pool, int minSize, float delta);
   void removeZeroPAs(Genpool &pool, float delta);
   void removeZeroPAs(genome &gen, float delta);
+
+  /**
+   * @brief      Fitness ordered indices into pool.
+   *
+   * @details    Ascending like sort(pool) but the genomes are not moved.
+   *             topK / bottomK only order the k best / worst gens
+   *             (partial_sort), the best gen is the last index of topK and
+   *             the worst the first index of bottomK.
+   */
+  vector<int> fitnessOrder(const Genpool &pool);
+  vector<int> topK(const Genpool &pool, int k);
+  vector<int> bottomK(const Genpool &pool, int k);
+  /**
+   * @brief      Pairwise distances of the path signatures of all gens.
+   *
+   * @details    Uses |a-b|^2 = |a|^2 + |b|^2 - 2ab, the dot products of
+   *             all pairs are computed by one matrix product over the cells
+   *             visited by any gen (blocked over the cells to bound memory).
+   *             Sparse signatures use a sparse product instead.
+   *             Gens without signature are treated as empty paths.
+   */
+  Eigen::MatrixXd pairwiseDistances(const Genpool &pool);
   void calDistanceMat(Genpool &pool, Eigen::VectorXf& upperFlat);
   void getDivMeanStd(Genpool &pool, float& mean, float& stdev, float &min, float &max);
+
+  /**
+   * @brief      Approximate diversity based on the signature sketches.
+   *
+   * @details    Each gen is compared with samples random partners (all gens
+   *             if samples <= 0), the summed distance is scaled to the
+   *             population size. Gens without sketch count as empty paths.
+   *
+   * @param      error mean relative error of the sketch distance, measured
+   *             on up to 32 of the sampled pairs with the exact distance
+   */
+  void calDistanceSketch(Genpool &pool, Eigen::VectorXf& upperFlat, int samples, rng::Philox &generator, float &error);
+  void getDivMeanStd(Genpool &pool, float& mean, float& stdev, float &min, float &max,
+		     int samples, rng::Philox &generator, float &error);
+
+  /////////////////////////////////////////////////////////////////////////////
+  //                             DiversityMatrix                             //
+  /////////////////////////////////////////////////////////////////////////////
+
+  /**
+   * @brief      Pairwise distances that persist across generations.
+   *
+   * @details    Each evaluated path (the signature shared by all copies of
+   *             a gen) owns a row of the matrix. An update only computes
+   *             the rows of paths that are new to the pool and drops the
+   *             rows of paths that left it; the summed distances of the
+   *             remaining rows are corrected by the changed columns.
+   *             Copies of a gen in the pool are counted with multiplicity,
+   *             which yields the same sums as calDistanceMat.
+   */
+  struct DiversityMatrix {
+    void update(Genpool &pool, Eigen::VectorXf& upperFlat);
+    void clear();
+    int size() const {return slots.size();}
+
+    // Rows computed during the last update
+    int computedRows = 0;
+
+  private:
+    int addSlot(shared_ptr<const PathSignature> sig);
+    void adjustCount(int slot, int count);
+
+    unordered_map<const PathSignature*, int> slots;
+    vector<shared_ptr<const PathSignature>> sigs;
+    vector<int> counts;
+    vector<int> freeSlots;
+    Eigen::MatrixXd D;
+    Eigen::VectorXd sums;
+  };
+  void getDivMeanStd(Genpool &pool, DiversityMatrix &divMat, float& mean, float& stdev, float &min, float &max);
   // genome calMeanGen(Genpool& pool, int maxActionSize);
 }
 
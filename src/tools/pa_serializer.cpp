@@ -11,23 +11,24 @@ bool pa_serializer::writeActionsToFile(vector<path::PAs> &paths, const fs::path&
   // id | x | y
   std::ostringstream f;
   std::ofstream ofs;
+  ActionTable table;
   for(auto &apath : paths){
-    for (auto it = apath.begin(); it != apath.end(); ++it) {
-      //debug("Action: ", )
-      assert((*it)->wps.size() > 0);
-      switch(it->get()->type){
+    table.clear();
+    for(auto &pa : apath)
+      table.push_back(*pa);
+    for(int i=0; i<table.size(); i++){
+      const Position &start = table.start[i];
+      const Position &end = table.end[i];
+      switch(table.type[i]){
       case PAT::Start:{
 	// Syntax type|(x1|y1),
-	Position start = (*it)->wps.front();
 	f << static_cast<int>(PAT::Start)<< "|"
 	   << start[0] << ":" << start[1] << ",";
 	break;
       }
       case PAT::Ahead: case PAT::CAhead:{
 	// Syntax type|(x1|y1)|(x2|y2),
-	Position start = (*it)->wps.front();
-	Position end = (*it)->wps.back();
-	f << static_cast<int>((*it)->type) << "|"
+	f << static_cast<int>(table.type[i]) << "|"
 	  << start[0] << ":" << start[1] << "|"
 	  << end[0] << ":" << end[1] << ",";
 	break;
@@ -35,8 +36,7 @@ bool pa_serializer::writeActionsToFile(vector<path::PAs> &paths, const fs::path&
       case PAT::End:{
 	// TODO: Not completely correct, endpoints are still ignored
 	// Syntax type|(x1|y1)\n
-	Position start = (*it)->wps.front();
-	f << static_cast<int>((*it)->type)<< "|"
+	f << static_cast<int>(table.type[i])<< "|"
 	  << start[0] << ":" << start[1] << "\n";
 	break;
       }
@@ -65,8 +65,7 @@ Position getPositionFromString(string pos){
   return Position(stof(pp[0]), stof(pp[1]));
 }
 
-shared_ptr<PathAction> getPAFromString(string action){
-  shared_ptr<PathAction> pa;
+void addPAFromString(string action, ActionTable &table){
   stringstream ss(action);
   string sub;
   vector<string> aParts;
@@ -79,45 +78,172 @@ shared_ptr<PathAction> getPAFromString(string action){
   case static_cast<int>(PAT::Start):{
     assert(aParts.size() == 2);
     Position start = getPositionFromString(aParts[1]);
-    pa = make_shared<StartAction>(StartAction(start));
+    table.push_back(PAT::Start, start, start);
     // cout << "Start" << start;
     break;
   }
   case static_cast<int>(PAT::Ahead): case static_cast<int>(PAT::CAhead):{
     assert(aParts.size() == 3);
-    AheadAction aa(static_cast<PAT>(stoi(aParts[0])), {});
     Position start = getPositionFromString(aParts[1]);
     Position end = getPositionFromString(aParts[2]);
-    aa.setConfigByWaypoints(start, end);
-    pa = make_shared<AheadAction>(aa);
+    table.push_back(static_cast<PAT>(stoi(aParts[0])), start, end);
     break;
   }
   case static_cast<int>(PAT::End):{
     assert(aParts.size() == 2);
     Position start = getPositionFromString(aParts[1]);
-    pa = make_shared<EndAction>(EndAction({start}));
+    table.push_back(PAT::End, start, start);
     break;
   }
   }
-  return pa;
 }
 
 bool pa_serializer::readActrionsFromFile(vector<path::PAs> &paths, const fs::path &p){
 
   ifstream Reader(p);
   string sequence;
+  ActionTable table;
 
   while(getline(Reader, sequence)){
     vector<string> actions;
     stringstream ss(sequence);
-    PAs gen;
+    table.clear();
     while (ss.good()){
       string sub;
       getline(ss, sub, ',');
       cout << sub << endl;
-      gen.push_back(getPAFromString(sub));
+      addPAFromString(sub, table);
     }
-    paths.push_back(gen);
+    paths.push_back(table.toActions());
   }
   return true;
 }
+
+///////////////////////////////////////////////////////////////////////////////
+//                              Binary encoding                              //
+///////////////////////////////////////////////////////////////////////////////
+
+template<typename T>
+static void putBytes(vector<char> &buffer, const T *data, size_t n){
+  auto raw = reinterpret_cast<const char*>(data);
+  buffer.insert(buffer.end(), raw, raw + n * sizeof(T));
+}
+
+template<typename T>
+static bool getBytes(const char *&pos, const char *end, T *data, size_t n){
+  if(static_cast<size_t>(end - pos) < n * sizeof(T))
+    return false;
+  memcpy(data, pos, n * sizeof(T));
+  pos += n * sizeof(T);
+  return true;
+}
+
+void pa_serializer::encodeGenome(const genome_tools::genome &gen, vector<char> &buffer){
+  buffer.clear();
+  float results[] = {gen.fitness, gen.traveledDist, gen.cross, gen.p_obj, gen.rotationCost,
+		     gen.coverage, gen.pixelCrossCoverage, gen.pathLengh, gen.rotations,
+		     gen.finalCoverage, gen.finalTime, gen.finalRotationTime};
+  putBytes(buffer, results, 12);
+  int32_t covered = gen.covered;
+  uint8_t reachEnd = gen.reachEnd;
+  putBytes(buffer, &covered, 1);
+  putBytes(buffer, &reachEnd, 1);
+
+  ActionTable table(gen.actions);
+  uint32_t n = table.size();
+  putBytes(buffer, &n, 1);
+  for(auto t : table.type){
+    uint8_t type = static_cast<uint8_t>(t);
+    putBytes(buffer, &type, 1);
+  }
+  putBytes(buffer, table.angle.data(), n);
+  putBytes(buffer, table.distance.data(), n);
+  // First and last waypoint per action
+  vector<double> coords;
+  coords.reserve(4 * n);
+  for(int i=0; i<n; i++)
+    coords.insert(coords.end(), {table.start[i].x(), table.start[i].y(), table.end[i].x(), table.end[i].y()});
+  putBytes(buffer, coords.data(), coords.size());
+  putBytes(buffer, table.counters.data(), n);
+  putBytes(buffer, table.modified.data(), n);
+
+  int32_t shape[2] = {0, 0};
+  uint32_t nnz = 0;
+  if(gen.signature){
+    shape[0] = gen.signature->rows;
+    shape[1] = gen.signature->cols;
+    nnz = gen.signature->cells.size();
+  }
+  putBytes(buffer, shape, 2);
+  putBytes(buffer, &nnz, 1);
+  if(nnz > 0){
+    putBytes(buffer, gen.signature->cells.data(), nnz);
+    putBytes(buffer, gen.signature->values.data(), nnz);
+  }
+}
+
+bool pa_serializer::decodeGenome(const char *data, size_t size, genome_tools::genome &gen, int sketchSize){
+  const char *pos = data, *end = data + size;
+  float results[12];
+  int32_t covered;
+  uint8_t reachEnd;
+  uint32_t n;
+  if(!getBytes(pos, end, results, 12) or !getBytes(pos, end, &covered, 1)
+     or !getBytes(pos, end, &reachEnd, 1) or !getBytes(pos, end, &n, 1))
+    return false;
+
+  ActionTable table;
+  vector<uint8_t> types(n);
+  table.angle.resize(n);
+  table.distance.resize(n);
+  vector<double> coords(4 * n);
+  table.counters.resize(n);
+  table.modified.resize(n);
+  if(!getBytes(pos, end, types.data(), n)
+     or !getBytes(pos, end, table.angle.data(), n)
+     or !getBytes(pos, end, table.distance.data(), n)
+     or !getBytes(pos, end, coords.data(), 4 * n)
+     or !getBytes(pos, end, table.counters.data(), n)
+     or !getBytes(pos, end, table.modified.data(), n))
+    return false;
+  for(int i=0; i<n; i++){
+    table.type.push_back(static_cast<PAT>(types[i]));
+    table.start.push_back(Position(coords[4*i], coords[4*i+1]));
+    table.end.push_back(Position(coords[4*i+2], coords[4*i+3]));
+  }
+
+  int32_t shape[2];
+  uint32_t nnz;
+  if(!getBytes(pos, end, shape, 2) or !getBytes(pos, end, &nnz, 1))
+    return false;
+  shared_ptr<genome_tools::PathSignature> sig;
+  if(shape[0] > 0){
+    sig = make_shared<genome_tools::PathSignature>();
+    sig->rows = shape[0];
+    sig->cols = shape[1];
+    sig->cells.resize(nnz);
+    sig->values.resize(nnz);
+    if(!getBytes(pos, end, sig->cells.data(), nnz) or !getBytes(pos, end, sig->values.data(), nnz))
+      return false;
+    if(sketchSize > 0)
+      sig->project(sketchSize);
+  }
+
+  gen = genome_tools::genome(table.toActions());
+  gen.fitness = results[0];
+  gen.traveledDist = results[1];
+  gen.cross = results[2];
+  gen.p_obj = results[3];
+  gen.rotationCost = results[4];
+  gen.coverage = results[5];
+  gen.pixelCrossCoverage = results[6];
+  gen.pathLengh = results[7];
+  gen.rotations = results[8];
+  gen.finalCoverage = results[9];
+  gen.finalTime = results[10];
+  gen.finalRotationTime = results[11];
+  gen.covered = covered;
+  gen.reachEnd = reachEnd;
+  gen.signature = sig;
+  return true;
+}
@@ -2,6 +2,8 @@
 #define PA_SERIALIZER_H
 
 #include "path_tools.h"
+#include "action_table.h"
+#include "genome_tools.h"
 #include <iostream>
 #include <fstream>
 
@@ -11,5 +13,22 @@ namespace fs = std::filesystem;
 namespace pa_serializer {
   bool writeActionsToFile(vector<path::PAs>& paths, const fs::path& p);
   bool readActrionsFromFile(vector<path::PAs>& paths, const fs::path& p);
+
+  /**
+   * @brief      Compact binary encoding of a gen (exchange between processes).
+   *
+   * @details    Contains the actions (rows of an ActionTable, waypoints
+   *             are stored exactly), the evaluation results and the path
+   *             signature. Only valid on hosts with the same byte order.
+   */
+  void encodeGenome(const genome_tools::genome &gen, vector<char> &buffer);
+  /**
+   * @brief      Restore a gen from encodeGenome, the gen gets a new id.
+   *
+   * @param      sketchSize project the signature (diversitySketch)
+   *
+   * @return     false if the data is incomplete
+   */
+  bool decodeGenome(const char *data, size_t size, genome_tools::genome &gen, int sketchSize=0);
 }
 #endif /* PA_SERIALIZER_H */
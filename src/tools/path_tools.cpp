@@ -15,28 +15,26 @@ using namespace path;
 //                                Path Helper                                //
 ///////////////////////////////////////////////////////////////////////////////
 
-template<typename K, typename V>
-void path::updateConfig(map<K,V> &config, map<K,V> &update){
+template<typename Config>
+void path::updateConfig(Config &config, const Config &update){
     for (auto &[key, value] : config){
-      if(update.find(key) != update.end()){
-	value = update[key];
+      auto it = update.find(key);
+      if(it != update.end()){
+	value = it->second;
        }
     }
 }
 
-template<typename K, typename V>
-void resetConfParameter(map<K, V> &config, K key){
+template<typename Config, typename K>
+void resetConfParameter(Config &config, K key){
   // set Parameter if not exists
-  auto ret = config.insert(pair(key, 0.0));
-  if(ret.second == false){
-    config[key] = 0;
-  }
+  config[key] = 0;
 }
 
-template<typename K, typename V>
-void incConfParameter(map<K, V> &config,const K key, V value){
+template<typename Config, typename K, typename V>
+void incConfParameter(Config &config, const K key, V value){
   // set Parameter if not exists
-  auto ret = config.insert(pair(key, value));
+  auto ret = config.insert({key, value});
   if(ret.second == false){
     config[key]++;
   }
@@ -80,14 +78,15 @@ bool path::compareF(float f1, float f2, float epsilon){
 //                                   PathAction                                  //
 ///////////////////////////////////////////////////////////////////////////////
 
-uint32_t path::PathAction::id = 0;
+atomic<uint32_t> path::PathAction::id(0);
+atomic<uint32_t> path::Robot::nextEpoch(0);
 
 WPs path::PathAction::generateWPs(Position start) {
   // debug("Haha geflaxt!!");
   // debug("MyType: ", static_cast<int>(type));
   assertm(!(PAT::CAhead == type || PAT::Ahead == type), "C/Ahead called generic Implementation!!");
   modified = false;
-  return wps;
+  return WPs(wps.begin(), wps.end());
 }
 
 bool path::PathAction::updateConf(PAP param, float val) {
@@ -211,7 +210,7 @@ WPs path::AheadAction::generateWPs(Position start) {
 
   // }
   // assertm(mod_config[PAP::Distance], "");
-  return wps;
+  return WPs(wps.begin(), wps.end());
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -250,7 +249,8 @@ WPs path::EndAction::generateWPs(Position start){
 path::Robot::Robot(rob_config conf, shared_ptr<GridMap> gmap, string mapOperationName)
   :cMap(*gmap),
    pmap(gmap),
-   opName(mapOperationName){
+   opName(mapOperationName),
+   cpEpoch(nextEpoch++){
   defaultConfig = {
        {RobotProperty::Width, 1},
        {RobotProperty::Height, 1},
@@ -259,6 +259,7 @@ path::Robot::Robot(rob_config conf, shared_ptr<GridMap> gmap, string mapOperatio
 
   updateConfig(defaultConfig, conf);
   pmap->add(opName, 0);
+  stamps = StampMatrix::Zero(pmap->getSize()(0), pmap->getSize()(1));
   resetCounter();
   // initPAidx(pmap->getSize().x(), pmap->getSize().y());
 }
@@ -268,6 +269,9 @@ bool path::Robot::execute(shared_ptr<PathAction> action, shared_ptr<grid_map::Gr
 
   int steps = 0;
   bool res = false;
+  // Executions outside of evaluateActions are not tracked by the journal
+  if(cellLog == nullptr)
+    journalValid = false;
 
   Position pos(currentPos);
 
@@ -275,7 +279,7 @@ bool path::Robot::execute(shared_ptr<PathAction> action, shared_ptr<grid_map::Gr
   case PAT::Start:{
     resetCounter();
     // map.clear("map");
-    map->add(opName, 0.0);
+    resetCoverage();
     // get start position for all following actions
     currentPos = action->generateWPs(currentPos)[0];
     // debug("Startpoint: ", currentPos);
@@ -328,9 +332,14 @@ bool path::Robot::evaluateActions(PAs &pas){
   bool success = false;
   bool overrideChanges = true;
   // resetPAidx();
-  for(PAs::iterator it = begin(pas); it != end(pas); it++){
+  int reused = restorePrefix(pas);
+  Checkpoint last = reused > 0 ? pas[reused-1]->cp : nullptr;
+  vector<int> cells;
+  for(PAs::iterator it = next(begin(pas), reused); it != end(pas); it++){
     // debug("--------------------");
 
+    // Execution rewrites waypoints, counters and checkpoint of the action
+    detach(*it);
     bool init = ((*it)->wps.size() == 0 ) and !(*it)->modified;
     // assertm()
     assertm(!((*it)->type == PAT::Start && init), "Init should be skipped if start action appeared!");
@@ -341,13 +350,40 @@ bool path::Robot::evaluateActions(PAs &pas){
       (*it)->generateWPs((*prev(it, 1))->wps.back());
     }
 
+    size_t pathSize = traveledPath.size();
+    if(incremental){
+      cells.clear();
+      cellLog = &cells;
+    }
     success = execute(*it, pmap);
+    cellLog = nullptr;
+    if(incremental){
+      // Record the result of the action for later evaluations
+      auto cp = make_shared<ActionCheckpoint>();
+      cp->prev = last;
+      cp->type = (*it)->type;
+      cp->start = (*it)->wps.front();
+      cp->end = (*it)->wps.back();
+      cp->endPos = currentPos;
+      for(int i=0; i<4; i++)
+	cp->counters[i] = (*it)->c_config[static_cast<Counter>(i)];
+      cp->stationary = isStationary(pmap, (*it)->mod_config[PAP::Distance]);
+      cp->reusable = success and !init and (*it)->type != PAT::End;
+      cp->epoch = cpEpoch;
+      cp->cells = cells;
+      cp->pathPoints = traveledPath.size() - pathSize;
+      (*it)->cp = cp;
+      journal.push_back(cp);
+      last = cp;
+    }
     // debug("Success: ", success);
     // do not propagate changes when actions are initialized
     if(!(success || init)){
       auto it_next = next(it, 1);
       auto it_prev = it;
-      while(it_next != pas.end() && !((*it_next)->mendConfig(*it_prev, overrideChanges))){
+      while(it_next != pas.end()){
+	detach(*it_next);
+	if((*it_next)->mendConfig(*it_prev, overrideChanges)) break;
 	// debug("Propagate change ", static_cast<int>((*it_next)->type));
 	it_prev = it_next;
 	it_next++;
@@ -359,6 +395,145 @@ bool path::Robot::evaluateActions(PAs &pas){
   return true;
 }
 
+int path::Robot::restorePrefix(PAs &pas){
+  if(!incremental or pas.empty()){
+    journalValid = false;
+    return 0;
+  }
+  // Longest prefix that still produces the recorded coverage
+  int prefix = 0;
+  Checkpoint last = nullptr;
+  for(auto &pa : pas){
+    if(!checkpointValid(pa, last)) break;
+    last = pa->cp;
+    prefix++;
+  }
+
+  if(prefix == 0){
+    // The start action will reset the coverage layer
+    journal.clear();
+    journalValid = pas.front()->type == PAT::Start;
+    return 0;
+  }
+
+  Matrix& data = (*pmap)[opName];
+  // Journal cells belong to the current coverage epoch
+  float *raw = data.data();
+  // Keep the part of the journal that is shared with the prefix
+  size_t common = 0;
+  if(journalValid){
+    while(common < journal.size() && common < (size_t) prefix && journal[common] == pas[common]->cp)
+      common++;
+    for(size_t i = common; i < journal.size(); i++)
+      for(int c : journal[i]->cells) raw[c]--;
+  }else{
+    resetCoverage();
+  }
+  journal.resize(common);
+
+  resetCounter();
+  for(int i=0; i<prefix; i++){
+    auto &pa = pas[i];
+    // Copy, pa might be detached below
+    Checkpoint cp = pa->cp;
+    if(i >= (int) common){
+      for(int c : cp->cells) coverCell(data, c)++;
+      journal.push_back(cp);
+    }
+    for(int j=0; j<4; j++){
+      auto counter = static_cast<Counter>(j);
+      // Shared actions usually carry the counters of the checkpoint already
+      auto known = pa->c_config.find(counter);
+      if(known != pa->c_config.end() and known->second == cp->counters[j])
+	continue;
+      detach(pa);
+      pa->c_config[counter] = cp->counters[j];
+    }
+    // The robot appends start and end of every move to the path
+    if(cp->pathPoints > 0){
+      traveledPath.push_back(cp->start);
+      traveledPath.push_back(cp->endPos);
+    }
+    incConfParameter(typeCount, pa->type, 1);
+  }
+  currentPos = last->endPos;
+  journalValid = true;
+  return prefix;
+}
+
+void path::Robot::detach(shared_ptr<PathAction> &pa){
+  if(pa.use_count() > 1)
+    pa = pa->clone();
+}
+
+bool path::Robot::checkpointValid(shared_ptr<PathAction> &pa, const Checkpoint &prev){
+  const Checkpoint &cp = pa->cp;
+  if(!cp or !cp->reusable or cp->epoch != cpEpoch or cp->prev != prev)
+    return false;
+  if(pa->modified or cp->type != pa->type or pa->wps.empty())
+    return false;
+  if(pa->wps.front() != cp->start or pa->wps.back() != cp->end)
+    return false;
+  if(pa->type == PAT::Start)
+    return prev == nullptr;
+  return isStationary(pmap, pa->mod_config[PAP::Distance]) == cp->stationary;
+}
+
+bool path::Robot::isStationary(shared_ptr<GridMap> cmap, float distance){
+  return distance == 0;
+}
+
+void path::Robot::resetCoverage(){
+  Matrix &data = (*pmap)[opName];
+  touched.clear();
+  if(stamps.rows() != data.rows() or stamps.cols() != data.cols() or ++coverEpoch == 0){
+    // Stamps cannot be distinguished anymore, clear the layer
+    data.setZero();
+    stamps = StampMatrix::Zero(data.rows(), data.cols());
+    coverEpoch = 0;
+  }
+}
+
+void path::Robot::syncCoverage(){
+  Matrix &data = (*pmap)[opName];
+  // Stamps stay untouched, later writes of this epoch are still recorded in touched
+  data.array() = (stamps.array() == coverEpoch).select(data.array(), 0.0f);
+}
+
+void path::Robot::invalidateCheckpoints(){
+  cpEpoch = nextEpoch++;
+  journal.clear();
+  journalValid = false;
+  // Packed layers are outdated as well
+  if(obstacleBits)
+    packLayers(true);
+}
+
+void path::Robot::packLayers(bool enable){
+  if(enable){
+    obstacleBits = make_shared<const BitLayer>((*pmap)["obstacle"]);
+    // Only the PolyRobot requires the covered layer
+    if(pmap->exists("covered"))
+      coveredBits = make_shared<const BitLayer>((*pmap)["covered"]);
+  }else{
+    obstacleBits.reset();
+    coveredBits.reset();
+  }
+}
+
+void path::Robot::adoptSettings(const Robot &rob){
+  // The clone operates on the same map, checkpoints can be shared
+  cpEpoch = rob.cpEpoch;
+  incremental = rob.incremental;
+  obstacleBits = rob.obstacleBits;
+  coveredBits = rob.coveredBits;
+}
+
+shared_ptr<Robot> path::Robot::clone(shared_ptr<GridMap> gmap){
+  auto rob = make_shared<Robot>(Robot(defaultConfig, gmap, opName));
+  rob->adoptSettings(*this);
+  return rob;
+}
 
 void path::Robot::resetCounter() {
   typeCount = {{PathActionType::Ahead, 0},
@@ -404,7 +579,7 @@ bool path::Robot::mapMove(shared_ptr<GridMap> cmap, shared_ptr<PathAction> actio
   // Check if points are in range
   // assertm(cmap->isInside(start), "Start-point is not in map range!");
   assertm(cmap->atPosition("obstacle", start) == 0, "Start Position is inside obstacle!!");
-  if(action->mod_config[PAP::Distance] == 0){
+  if(isStationary(cmap, action->mod_config[PAP::Distance])){
     // Action is not doing anything, delete it!!
     // warn("Delete action ", action->pa_id, ", distance between start and endpoint == ", (waypoints.back()-waypoints.front()).norm());
 
@@ -412,13 +587,12 @@ bool path::Robot::mapMove(shared_ptr<GridMap> cmap, shared_ptr<PathAction> actio
   }
 
   Index lastIdx;
-  // TODO: setting values directly in the matrix is faster!
-  // Matrix& moveMap = (*cmap)[opName];
+  Matrix& data = (*cmap)[opName];
   // Matrix& obstacleMap = (*cmap)["obstacle"];
   for(grid_map::LineIterator lit(*cmap, start, lastPos) ; !lit.isPastEnd(); ++lit){
 
     // Check if start or endpoint collidates with obstacle
-    float obstacle = cmap->at("obstacle", *lit);
+    float obstacle = obstacleBits ? obstacleBits->test((*lit)(0), (*lit)(1)) : cmap->at("obstacle", *lit);
     // std::cout << "Cell" << "\n";
 
     if(obstacle > 0){
@@ -439,14 +613,17 @@ bool path::Robot::mapMove(shared_ptr<GridMap> cmap, shared_ptr<PathAction> actio
       lastIdx = *lit;
       if (clean){
 
-	float mapVal = cmap->at(opName, *lit);
+	const int cell = (*lit)(0) + (*lit)(1) * data.rows();
+	float &mapVal = coverCell(data, cell);
 
 	if (mapVal > 0){
 	  action->c_config[Counter::CrossCount]++;
 	}
 
 	action->c_config[Counter::StepCount]++;
-	cmap->at(opName, *lit)++;
+	mapVal++;
+	if(cellLog)
+	  cellLog->push_back(cell);
 	// debug("Mark map");
       }
       steps++;
@@ -470,6 +647,8 @@ bool path::Robot::mapMove(shared_ptr<GridMap> cmap, shared_ptr<PathAction> actio
 
 
 cv::Mat path::Robot::gridToImg(string layer){
+  if(layer == opName)
+    syncCoverage();
   cv::Mat img = mapgen::gmapToImg(mapgen::changeMapRes(pmap, 0.2), layer);
   // grid_map::GridMapCvConverter::toImage<unsigned char, 1>(*pmap, layer, CV_8U, 0.0, 6, img);
   return img;
@@ -548,6 +727,17 @@ void path::Robot::intersect(shared_ptr<PathAction> pa, int x, int y){
 //                                 Poly Robot                                //
 ///////////////////////////////////////////////////////////////////////////////
 
+shared_ptr<Robot> path::PolyRobot::clone(shared_ptr<GridMap> gmap){
+  auto rob = make_shared<PolyRobot>(PolyRobot(defaultConfig, gmap, opName));
+  rob->adoptSettings(*this);
+  rob->scanline = scanline;
+  return rob;
+}
+
+bool path::PolyRobot::isStationary(shared_ptr<GridMap> cmap, float distance){
+  return distance < cmap->getResolution();
+}
+
 bool path::PolyRobot::mapMove(shared_ptr<GridMap> cmap, shared_ptr<PathAction> action, int &steps, Position &currentPos, WPs &path, bool clean){
   bool adapted = false;
 
@@ -575,7 +765,7 @@ bool path::PolyRobot::mapMove(shared_ptr<GridMap> cmap, shared_ptr<PathAction> a
     action->wps[1] = waypoints.back();
   }
   // debug("Actual Distance: ", action->mod_config[PAP::Distance]);
-  if(action->mod_config[PAP::Distance] < cmap->getResolution()){
+  if(isStationary(cmap, action->mod_config[PAP::Distance])){
     // debug("Action has 0 distance: ");
     // action->wps.back() = action->wps.front();
     // action->mod_config[PAP::Distance] = 0;
@@ -593,20 +783,28 @@ bool path::PolyRobot::mapMove(shared_ptr<GridMap> cmap, shared_ptr<PathAction> a
   grid_map::Matrix& obj = (*cmap)["obstacle"];
   grid_map::Matrix& covered = (*cmap)["covered"];
 
-  // Iterate over all pixel, covered by the polygon
-  for (grid_map::PolygonIterator it(*cmap, poly);
-      !it.isPastEnd(); ++it) {
-    const Index idx(*it);
-    //
-
-    if(obj(idx(0), idx(1)) > 0){
-      action->c_config[Counter::ObjCount] += 1;
-    }else{
-      if(data(idx(0), idx(1)) > 0)
-	action->c_config[Counter::CrossCount]++;
-      action->c_config[Counter::StepCount]++;
-      data(idx(0), idx(1))++;
-      action->c_config[Counter::CoverdCount] += covered(idx(0), idx(1));
+  if(scanline and polygonSpans(*cmap, poly, spans)){
+    markSpans(cmap, spans, action);
+  }else{
+    // Iterate over all pixel, covered by the polygon
+    for (grid_map::PolygonIterator it(*cmap, poly);
+	 !it.isPastEnd(); ++it) {
+      const Index idx(*it);
+      //
+
+      if(obj(idx(0), idx(1)) > 0){
+	action->c_config[Counter::ObjCount] += 1;
+      }else{
+	const int cell = idx(0) + idx(1) * data.rows();
+	float &val = coverCell(data, cell);
+	if(val > 0)
+	  action->c_config[Counter::CrossCount]++;
+	action->c_config[Counter::StepCount]++;
+	val++;
+	if(cellLog)
+	  cellLog->push_back(cell);
+	action->c_config[Counter::CoverdCount] += covered(idx(0), idx(1));
+      }
     }
   }
 
@@ -622,3 +820,163 @@ bool path::PolyRobot::mapMove(shared_ptr<GridMap> cmap, shared_ptr<PathAction> a
 
   return not adapted;
 }
+
+void path::PolyRobot::markSpans(shared_ptr<GridMap> cmap, const vector<Span> &spans, shared_ptr<PathAction> action){
+  grid_map::Matrix& data = (*cmap)[opName];
+  grid_map::Matrix& obj = (*cmap)["obstacle"];
+  grid_map::Matrix& covered = (*cmap)["covered"];
+
+  int steps = 0, cross = 0, objects = 0, cov = 0;
+  for(const Span &span : spans){
+    // Cells of a span are contiguous (column major storage)
+    const int n = span.last - span.first + 1;
+    float *d = &data(span.first, span.col);
+    const float *o = &obj(span.first, span.col);
+    const float *c = &covered(span.first, span.col);
+    uint16_t *st = &stamps(span.first, span.col);
+    const int offset = span.first + span.col * data.rows();
+    for(int i=0; i<n; i++)
+      if(st[i] != coverEpoch)
+	touched.push_back(offset + i);
+    if(obstacleBits){
+      // Count obstacles and covered cells word wise
+      const int blocked = obstacleBits->count(span.col, span.first, span.last);
+      objects += blocked;
+      steps += n - blocked;
+      cov += coveredBits->countExcept(*obstacleBits, span.col, span.first, span.last);
+      const uint64_t *ob = obstacleBits->column(span.col);
+      for(int i=0, row=span.first; i<n; i++, row++){
+	const int drivable = 1 - static_cast<int>((ob[row >> 6] >> (row & 63)) & 1);
+	const float val = st[i] == coverEpoch ? d[i] : 0.0f;
+	cross += drivable & (val > 0);
+	d[i] = val + drivable;
+	st[i] = coverEpoch;
+      }
+    }else{
+      // Branch free such that the loop can be vectorized
+      for(int i=0; i<n; i++){
+	const int blocked = o[i] > 0;
+	const int drivable = 1 - blocked;
+	// Cells of an old epoch count as zero
+	const float val = st[i] == coverEpoch ? d[i] : 0.0f;
+	objects += blocked;
+	cross += drivable & (val > 0);
+	steps += drivable;
+	cov += drivable * static_cast<int>(c[i]);
+	d[i] = val + drivable;
+	st[i] = coverEpoch;
+      }
+    }
+    if(cellLog){
+      for(int i=0; i<n; i++){
+	const bool blocked = obstacleBits ? obstacleBits->test(span.first + i, span.col) : o[i] > 0;
+	if(!blocked) cellLog->push_back(offset + i);
+      }
+    }
+  }
+  action->c_config[Counter::StepCount] += steps;
+  action->c_config[Counter::CrossCount] += cross;
+  action->c_config[Counter::ObjCount] += objects;
+  action->c_config[Counter::CoverdCount] += cov;
+}
+
+bool path::polygonSpans(const GridMap &map, const grid_map::Polygon &poly, vector<Span> &spans){
+  spans.clear();
+  if(!map.getStartIndex().isZero())
+    return false;
+
+  const Size size = map.getSize();
+  const double res = map.getResolution();
+  const auto &vertices = poly.getVertices();
+  // Positions decrease with increasing indices, start at the center of cell (0,0)
+  Position origin;
+  map.getPosition(Index(0, 0), origin);
+
+  double minY = vertices.front().y(), maxY = minY;
+  for(const auto &v : vertices){
+    minY = min(minY, v.y());
+    maxY = max(maxY, v.y());
+  }
+  const int firstCol = max(0, static_cast<int>(floor((origin.y() - maxY) / res)));
+  const int lastCol = min(size(1) - 1, static_cast<int>(ceil((origin.y() - minY) / res)));
+
+  auto inside = [&](int row, int col){
+    Position p;
+    map.getPosition(Index(row, col), p);
+    return poly.isInside(p);
+  };
+
+  for(int col = firstCol; col <= lastCol; col++){
+    Position center;
+    map.getPosition(Index(0, col), center);
+    const double y = center.y();
+    // Intersect the scanline with the polygon edges (same test as Polygon::isInside)
+    double minX = numeric_limits<double>::max(), maxX = numeric_limits<double>::lowest();
+    int crossings = 0;
+    for(size_t i = 0, j = vertices.size() - 1; i < vertices.size(); j = i++){
+      const Position &vi = vertices[i], &vj = vertices[j];
+      if((vi.y() > y) != (vj.y() > y)){
+	const double x = (vj.x() - vi.x()) * (y - vi.y()) / (vj.y() - vi.y()) + vi.x();
+	minX = min(minX, x);
+	maxX = max(maxX, x);
+	crossings++;
+      }
+    }
+    if(crossings < 2)
+      continue;
+
+    // Estimate the span and align its borders with the point in polygon test
+    int first = max(0, static_cast<int>(floor((origin.x() - maxX) / res)));
+    int last = min(size(0) - 1, static_cast<int>(ceil((origin.x() - minX) / res)));
+    while(first <= last and !inside(first, col)) first++;
+    while(last >= first and !inside(last, col)) last--;
+    if(first > last)
+      continue;
+    while(first > 0 and inside(first - 1, col)) first--;
+    while(last < size(0) - 1 and inside(last + 1, col)) last++;
+    spans.push_back({col, first, last});
+  }
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                  BitLayer                                 //
+///////////////////////////////////////////////////////////////////////////////
+
+path::BitLayer::BitLayer(const Matrix &layer)
+  :rows(layer.rows()),
+   cols(layer.cols()),
+   wordsPerCol((layer.rows() + 63) / 64),
+   words(wordsPerCol * layer.cols(), 0){
+  for(int col=0; col<cols; col++){
+    uint64_t *w = &words[col * wordsPerCol];
+    for(int row=0; row<rows; row++)
+      if(layer(row, col) > 0)
+	w[row >> 6] |= uint64_t(1) << (row & 63);
+  }
+}
+
+// Popcount of the bits [first, last] with word(i) returning the i-th word of the column
+template<typename F>
+static int countBits(int first, int last, F word){
+  const int fw = first >> 6, lw = last >> 6;
+  const uint64_t fmask = ~uint64_t(0) << (first & 63);
+  const uint64_t lmask = ~uint64_t(0) >> (63 - (last & 63));
+  if(fw == lw)
+    return __builtin_popcountll(word(fw) & fmask & lmask);
+  int n = __builtin_popcountll(word(fw) & fmask);
+  for(int i = fw + 1; i < lw; i++)
+    n += __builtin_popcountll(word(i));
+  return n + __builtin_popcountll(word(lw) & lmask);
+}
+
+int path::BitLayer::count(int col, int first, int last) const{
+  const uint64_t *w = column(col);
+  return countBits(first, last, [w](int i){return w[i];});
+}
+
+int path::BitLayer::countExcept(const BitLayer &mask, int col, int first, int last) const{
+  const uint64_t *w = column(col);
+  const uint64_t *m = mask.column(col);
+  return countBits(first, last, [w, m](int i){return w[i] & ~m[i];});
+}
@@ -11,6 +11,8 @@
 #include <thread>
 #include <future>
 #include <exception>
+#include <atomic>
+#include <array>
 #include <grid_map_core/grid_map_core.hpp>
 #include <grid_map_cv/GridMapCvConverter.hpp>
 #include <cstring>
@@ -29,6 +31,7 @@
 // #define __DEBUG_WARN__ true
 
 #include "debug.h"
+#include "action_arena.h"
 using Vec2  = Eigen::Vector2f;
 using Line2 = Eigen::Hyperplane<float,2>;
 
@@ -74,6 +77,7 @@ namespace path {
     CoverdCount = 3
   };
   struct PathAction;
+  struct ActionCheckpoint;
 
   using RP = RobotProperty;
   using PAP = PathActionParameter;
@@ -81,19 +85,125 @@ namespace path {
   using namespace std;
   using time_sec = uint32_t;
   using distance_cm = uint32_t;
-  using rob_config = map<RobotProperty, float>;
-  using PA_config = map<PAP, float>;
+
+  /////////////////////////////////////////////////////////////////////////////
+  //                                 EnumMap                                 //
+  /////////////////////////////////////////////////////////////////////////////
+
+  /**
+   * @brief      Map with enum keys in [0, N) that stores its values in a fixed array.
+   *
+   * @details    Provides the subset of the std::map interface used for the
+   *             configurations ([], insert, find, count, iteration in key order).
+   *             A presence mask keeps the map semantics, e.g. insert does not
+   *             override existing values and iteration only visits inserted keys.
+   */
+  template<typename K, typename V, size_t N>
+  struct EnumMap {
+    static_assert(N <= 32, "Presence mask is limited to 32 keys");
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = pair<K, V>;
+
+    template<typename Map, typename Value>
+    struct Iter {
+      Map *m;
+      size_t i;
+      Iter& operator++(){i = m->next(i + 1); return *this;}
+      Value& operator*() const {return m->entries[i];}
+      Value* operator->() const {return &m->entries[i];}
+      bool operator==(const Iter &it) const {return i == it.i;}
+      bool operator!=(const Iter &it) const {return i != it.i;}
+    };
+    using iterator = Iter<EnumMap, value_type>;
+    using const_iterator = Iter<const EnumMap, const value_type>;
+
+    static constexpr size_t index(K key){return static_cast<size_t>(key);}
+
+    EnumMap(){
+      for(size_t i=0; i<N; i++)
+	entries[i] = {static_cast<K>(i), V()};
+    }
+    EnumMap(initializer_list<value_type> init):EnumMap(){insert(init);}
+
+    V& operator[](K key){
+      mask |= 1u << index(key);
+      return entries[index(key)].second;
+    }
+    const V& at(K key) const {
+      assertm(count(key), "Key not contained in EnumMap!");
+      return entries[index(key)].second;
+    }
+
+    pair<iterator, bool> insert(const value_type &val){
+      const size_t i = index(val.first);
+      const bool inserted = !count(val.first);
+      if(inserted){
+	mask |= 1u << i;
+	entries[i].second = val.second;
+      }
+      return {iterator{this, i}, inserted};
+    }
+    void insert(initializer_list<value_type> init){
+      for(auto &val : init)
+	insert(val);
+    }
+    size_t erase(K key){
+      if(!count(key)) return 0;
+      mask &= ~(1u << index(key));
+      entries[index(key)].second = V();
+      return 1;
+    }
+    void clear(){*this = EnumMap();}
+
+    size_t count(K key) const {return (mask >> index(key)) & 1;}
+    size_t size() const {return __builtin_popcount(mask);}
+    bool empty() const {return mask == 0;}
+
+    iterator find(K key){return count(key) ? iterator{this, index(key)} : end();}
+    const_iterator find(K key) const {return count(key) ? const_iterator{this, index(key)} : end();}
+    iterator begin(){return {this, next(0)};}
+    iterator end(){return {this, N};}
+    const_iterator begin() const {return {this, next(0)};}
+    const_iterator end() const {return {this, N};}
+
+    // First present index >= i
+    size_t next(size_t i) const {
+      while(i < N and !((mask >> i) & 1)) i++;
+      return i;
+    }
+
+    bool operator==(const EnumMap &other) const {
+      if(mask != other.mask) return false;
+      for(size_t i=0; i<N; i++)
+	if(((mask >> i) & 1) and !(entries[i].second == other.entries[i].second))
+	  return false;
+      return true;
+    }
+    bool operator!=(const EnumMap &other) const {return !(*this == other);}
+
+    array<value_type, N> entries;
+    uint32_t mask = 0;
+  };
+
+  using rob_config = EnumMap<RobotProperty, float, 5>;
+  using PA_config = EnumMap<PAP, float, 6>;
+  using C_config = EnumMap<Counter, int, 4>;
+  using type_count = EnumMap<PathActionType, int, 4>;
   using WPs = vector<grid_map::Position>;
+  // Waypoints of an action, kept in the arena of the action (see ArenaAllocator)
+  using ActionWPs = vector<grid_map::Position, ArenaAllocator<grid_map::Position>>;
   //Direction needs to be a normed vector
   using direction = grid_map::Position;
   using PAs = deque<shared_ptr<PathAction>>;
+  using Checkpoint = shared_ptr<const ActionCheckpoint>;
 
 
   // static grid_map::GridMap global_map;
   using namespace grid_map;
 
-  template<typename K, typename V>
-  void updateConfig(map<K,V> &config, map<K,V> &update);
+  template<typename Config>
+  void updateConfig(Config &config, const Config &update);
 
 
   //TODO: adapt to direction vector
@@ -117,19 +227,22 @@ namespace path {
   struct PathAction{
     // An action shold be initialized by an action type
     // or better we need an action factory that will generate an action based on the
-    static uint32_t id;
+    // Shared by all threads that create actions
+    static atomic<uint32_t> id;
 
     int pa_id;
     bool modified = false;
     PAT type;
     time_sec estimatedDuration;
-    WPs wps;
+    ActionWPs wps;
     PA_config mod_config;
-    map<Counter, int> c_config;
+    C_config c_config;
     Position endPoint;
+    // Coverage result of the last execution, see ActionCheckpoint
+    Checkpoint cp;
 
     PathAction(PAT type):
-      pa_id(id),
+      pa_id(id++),
       modified(false),
       type(type),
       c_config{
@@ -137,14 +250,12 @@ namespace path {
 	{Counter::CrossCount, 0},
 	{Counter::ObjCount, 0},
 	{Counter::CoverdCount, 0},
-      }{
-      id++;
-    };
+      }{};
 
 
-    WPs get_wps() { return wps; }
+    WPs get_wps() { return WPs(wps.begin(), wps.end()); }
 
-    void set_wps(WPs wps) { this->wps = wps; }
+    void set_wps(WPs wps) { this->wps.assign(wps.begin(), wps.end()); }
 
 
 
@@ -166,6 +277,8 @@ namespace path {
 
     bool updateConf(PAP param, float val);
     bool intersect(shared_ptr<PathAction> pa);
+    // Private copy of the action (see genome::detach)
+    virtual shared_ptr<PathAction> clone() const {return newAction<PathAction>(*this);}
   };
 
 
@@ -180,7 +293,7 @@ namespace path {
     AheadAction(path::PAT type, PA_config conf);
     // AheadAction(AheadAction &aa);
     virtual WPs generateWPs(Position start);
-
+    virtual shared_ptr<PathAction> clone() const override {return newAction<AheadAction>(*this);}
   };
 
   /////////////////////////////////////////////////////////////////////////////
@@ -202,6 +315,7 @@ For now we will just return the start point because the robot object should find
     virtual WPs generateWPs(Position start) override;
     virtual bool mendConfig(shared_ptr<PathAction> pa, bool overrideChanges) override {return true;};
     // virtual bool applyModifications() override {return true;}
+    virtual shared_ptr<PathAction> clone() const override {return newAction<EndAction>(*this);}
   };
 
   /////////////////////////////////////////////////////////////////////////////
@@ -216,19 +330,96 @@ For now we will just return the start point because the robot object should find
     };
     bool mendConfig(shared_ptr<PathAction> pa, bool overrideChanges){return true;};
     bool applyModifications(){return true;}
+    shared_ptr<PathAction> clone() const override {return newAction<StartAction>(*this);}
+  };
+
+  /////////////////////////////////////////////////////////////////////////////
+  //                             ActionCheckpoint                            //
+  /////////////////////////////////////////////////////////////////////////////
+
+  /**
+   * @brief      Immutable result of one action execution.
+   *
+   * @details    A checkpoint stores everything an action changed on the robot
+   *             and the coverage layer: the cells it incremented, its counters
+   *             and the resulting robot position.
+   *             It is only valid for the coverage state produced by its
+   *             predecessors, hence prev links the checkpoints of the whole
+   *             prefix. Actions that share a checkpoint (e.g. copied by
+   *             crossover) can reuse the prefix without executing it again.
+   */
+  struct ActionCheckpoint {
+    Checkpoint prev;
+    PAT type;
+    // Waypoints of the action after execution
+    Position start;
+    Position end;
+    // Robot position after execution
+    Position endPos;
+    int counters[4];
+    // Whether the distance was below the robot's movement threshold
+    bool stationary;
+    // Execution succeeded without altering the action
+    bool reusable;
+    // Robot lineage the checkpoint was recorded with
+    uint32_t epoch;
+    // Linear (column major) indices of incremented cells of the coverage layer
+    vector<int> cells;
+    // Number of points appended to the traveled path
+    int pathPoints = 0;
   };
 
   /////////////////////////////////////////////////////////////////////////////
   //                                  Robot                                  //
   /////////////////////////////////////////////////////////////////////////////
 
+  /*
+    Consecutive cells of one column of the map: index(0) in [first, last], index(1) = col.
+   */
+  struct Span {
+    int col;
+    int first;
+    int last;
+  };
+
+  /*
+    Collect all cells whose center lies inside the convex polygon as column spans.
+    The result is identical to the cells visited by grid_map::PolygonIterator.
+    Return false if the map buffer is wrapped (start index != 0), the spans
+    would not be contiguous in memory in that case.
+   */
+  bool polygonSpans(const GridMap &map, const grid_map::Polygon &poly, vector<Span> &spans);
+
+  /*
+    Binary copy of a static layer (cell > 0), every column is packed into 64 bit words.
+   */
+  struct BitLayer {
+    BitLayer(const Matrix &layer);
+
+    bool test(int row, int col) const {
+      return (column(col)[row >> 6] >> (row & 63)) & 1;
+    }
+    const uint64_t* column(int col) const { return &words[col * wordsPerCol]; }
+
+    // Number of set cells with index(0) in [first, last] of the column
+    int count(int col, int first, int last) const;
+    // Same as count but ignores cells that are set in mask
+    int countExcept(const BitLayer &mask, int col, int first, int last) const;
+
+    int rows;
+    int cols;
+    int wordsPerCol;
+    vector<uint64_t> words;
+  };
+
+  using StampMatrix = Eigen::Matrix<uint16_t, Eigen::Dynamic, Eigen::Dynamic>;
   using idxMap1D = vector<vector<shared_ptr<PathAction>>>;
   using idxMap2D = vector<idxMap1D>;
 
   struct Robot{
 
 
-    const map<PathActionType, int> get_typeCount() const { return typeCount; }
+    const type_count get_typeCount() const { return typeCount; }
 
     const WPs get_traveledPath() const { return traveledPath; }
 
@@ -243,8 +434,20 @@ For now we will just return the start point because the robot object should find
     */
     virtual bool execute(shared_ptr<PathAction> action, shared_ptr<GridMap> map);
 
+    /*
+      Execute all actions of the sequence.
+      When incremental evaluation is enabled the longest prefix with valid
+      checkpoints is restored from the journal instead of being executed.
+      Actions that are shared with other sequences are copied before they
+      are changed, the restored prefix stays shared.
+    */
     virtual bool evaluateActions(PAs &pas);
 
+    /*
+      Create a robot of the same type and configuration that operates on the given map.
+     */
+    virtual shared_ptr<Robot> clone(shared_ptr<GridMap> gmap);
+
     void resetCounter();
 
     /*
@@ -258,6 +461,65 @@ For now we will just return the start point because the robot object should find
      */
     virtual bool mapMove(shared_ptr<GridMap> cmap, shared_ptr<PathAction> action, int &steps, Position &currentPos, WPs &path, bool clean=true);
 
+    /*
+      Return true if an action with the given distance does not move the robot.
+     */
+    virtual bool isStationary(shared_ptr<GridMap> cmap, float distance);
+
+    /*
+      Drop all checkpoints recorded so far, needs to be called when a layer
+      that influences the execution (obstacle, covered) changed.
+      Robots cloned afterwards share the new checkpoints.
+     */
+    void invalidateCheckpoints();
+
+    /*
+      Build (or drop) the packed obstacle and covered layers used for collision tests.
+     */
+    void packLayers(bool enable=true);
+
+    /*
+      Copy the settings and shared state of rob (used when cloning).
+     */
+    void adoptSettings(const Robot &rob);
+
+    /*
+      Restore the coverage layer and counters of the longest prefix of pas
+      whose checkpoints are still valid. Return the length of the prefix.
+     */
+    int restorePrefix(PAs &pas);
+
+    /*
+      Replace pa by a private copy if other sequences reference it as well.
+     */
+    static void detach(shared_ptr<PathAction> &pa);
+
+    /*
+      Start a new coverage epoch, afterwards all cells of the coverage layer count as zero.
+      The layer is only cleared when the epoch counter wraps around.
+     */
+    void resetCoverage();
+
+    /*
+      Set all cells of the coverage layer that belong to an old epoch to zero.
+      Needs to be called before the whole layer (opName) is read outside of the robot,
+      cells listed in touched can be read without it.
+     */
+    void syncCoverage();
+
+    /*
+      Access the coverage layer by linear index, cells of an old epoch are reset first.
+     */
+    float& coverCell(Matrix &data, int idx){
+      if(stamps(idx) != coverEpoch){
+	stamps(idx) = coverEpoch;
+	touched.push_back(idx);
+	data(idx) = 0;
+      }
+      return data(idx);
+    }
+    bool checkpointValid(shared_ptr<PathAction> &pa, const Checkpoint &prev);
+
     cv::Mat gridToImg(string layer);
     void initPAidx(int width, int height);
     void resetPAidx();
@@ -272,7 +534,7 @@ For now we will just return the start point because the robot object should find
     grid_map::GridMap cMap;
     shared_ptr<GridMap> pmap;
     string opName;
-    map<PathActionType, int> typeCount;
+    type_count typeCount;
     rob_config defaultConfig;
     distance_cm traveledDist = 0;
     WPs traveledPath;
@@ -281,10 +543,40 @@ For now we will just return the start point because the robot object should find
     Position currentPos;
     int freeArea = 0;
     idxMap2D PA_idx;
+
+    // Reuse checkpoints of unchanged action prefixes while evaluating
+    bool incremental = true;
+    uint32_t cpEpoch;
+    static atomic<uint32_t> nextEpoch;
+    // Checkpoints of the actions that are currently marked on the coverage layer
+    vector<Checkpoint> journal;
+    // Journal describes the coverage layer (no foreign execution in between)
+    bool journalValid = false;
+    // Collects incremented cells during evaluateActions
+    vector<int> *cellLog = nullptr;
+    // Epoch of the last write to every cell of the coverage layer
+    StampMatrix stamps;
+    uint16_t coverEpoch = 0;
+    // Linear indices of the cells stamped in the current epoch (unordered)
+    vector<int> touched;
+    // Packed copies of the obstacle and covered layer, shared with clones
+    shared_ptr<const BitLayer> obstacleBits;
+    shared_ptr<const BitLayer> coveredBits;
   };
 
   struct PolyRobot : Robot{
     using Robot::Robot;
+    virtual shared_ptr<Robot> clone(shared_ptr<GridMap> gmap) override;
+    virtual bool isStationary(shared_ptr<GridMap> cmap, float distance) override;
+
+    /*
+      Mark the cells of the given spans on the coverage layer and update the counters of the action.
+     */
+    void markSpans(shared_ptr<GridMap> cmap, const vector<Span> &spans, shared_ptr<PathAction> action);
+
+    // Rasterize moves column wise instead of using the PolygonIterator
+    bool scanline = true;
+    vector<Span> spans;
     // virtual bool execute(shared_ptr<PathAction> action, shared_ptr<GridMap> map) override;
     // virtual bool evaluateActions(PAs &pas) override;
     virtual bool mapMove(shared_ptr<GridMap> cmap, shared_ptr<PathAction> action, int &steps, Position &currentPos, WPs &path, bool clean=true) override;
@@ -0,0 +1,40 @@
+#include "philox.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//                                  Philox                                   //
+///////////////////////////////////////////////////////////////////////////////
+
+void rng::Philox::seed(uint64_t s){
+  key = {static_cast<uint32_t>(s), static_cast<uint32_t>(s >> 32)};
+  stream(0, 0, 0);
+}
+
+void rng::Philox::seed(seed_seq &seq){
+  seq.generate(key.begin(), key.end());
+  stream(0, 0, 0);
+}
+
+void rng::Philox::stream(uint32_t generation, uint32_t individual, uint32_t op){
+  counter = {0, generation, individual, op};
+  idx = out.size();
+}
+
+void rng::Philox::refill(){
+  out = block(counter, key);
+  counter[0]++;
+  idx = 0;
+}
+
+std::array<uint32_t, 4> rng::Philox::block(array<uint32_t, 4> ctr, array<uint32_t, 2> k){
+  const uint64_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+  const uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+  for(int round=0; round<10; round++){
+    uint64_t p0 = M0 * ctr[0];
+    uint64_t p1 = M1 * ctr[2];
+    ctr = {static_cast<uint32_t>(p1 >> 32) ^ ctr[1] ^ k[0], static_cast<uint32_t>(p1),
+	   static_cast<uint32_t>(p0 >> 32) ^ ctr[3] ^ k[1], static_cast<uint32_t>(p0)};
+    k[0] += W0;
+    k[1] += W1;
+  }
+  return ctr;
+}
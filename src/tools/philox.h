@@ -0,0 +1,66 @@
+#ifndef PHILOX_H
+#define PHILOX_H
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <random>
+
+namespace rng {
+  using namespace std;
+
+  /////////////////////////////////////////////////////////////////////////////
+  //                                 Philox                                  //
+  /////////////////////////////////////////////////////////////////////////////
+
+  // Operators that draw from their own stream (last key of the counter)
+  enum class Op {Init, Selection, Crossover, Mutation, Replace, Diversity, Migration};
+
+  /**
+   * @brief      Counter based random engine (Philox4x32-10).
+   *
+   * @details    Every output block is a bijection of the counter
+   *             (block, generation, individual, operator) under the key
+   *             derived from the seed. A stream therefore depends only on
+   *             its keys and not on the numbers drawn before, which makes
+   *             the results independent of the order in which operators
+   *             run on different threads.
+   *             Satisfies UniformRandomBitGenerator and can be used with
+   *             the distributions of <random>.
+   */
+  class Philox {
+  public:
+    using result_type = uint32_t;
+
+    Philox(uint64_t s = 42){seed(s);}
+
+    void seed(uint64_t s);
+    void seed(seed_seq &seq);
+
+    // Jump to the beginning of the stream (generation, individual, op)
+    void stream(uint32_t generation, uint32_t individual, uint32_t op);
+
+    result_type operator()(){
+      if(idx == out.size())
+	refill();
+      return out[idx++];
+    }
+    void discard(unsigned long long n){for(; n > 0; n--) (*this)();}
+
+    static constexpr result_type min(){return 0;}
+    static constexpr result_type max(){return numeric_limits<result_type>::max();}
+
+    // Output block of counter under key (10 rounds)
+    static array<uint32_t, 4> block(array<uint32_t, 4> counter, array<uint32_t, 2> key);
+
+  private:
+    void refill();
+
+    array<uint32_t, 2> key;
+    array<uint32_t, 4> counter;
+    array<uint32_t, 4> out;
+    size_t idx = 4;
+  };
+}
+
+#endif /* PHILOX_H */
@@ -0,0 +1,84 @@
+#include "robot_pool.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//                                 RobotPool                                 //
+///////////////////////////////////////////////////////////////////////////////
+
+path::RobotPool::RobotPool(shared_ptr<Robot> rob, int threads){
+  if(threads <= 1){
+    robots.push_back(rob);
+    return;
+  }
+  for(int i=0; i<threads; i++){
+    // Each worker needs its own coverage layer
+    robots.push_back(rob->clone(make_shared<GridMap>(*rob->pmap)));
+  }
+}
+
+void path::RobotPool::run(int jobs, function<void(int, Robot&)> job){
+  assertm(robots.size() > 0, "RobotPool is not initialized!");
+  if(robots.size() == 1 or jobs < 2){
+    for(int i=0; i<jobs; i++)
+      job(i, *robots.front());
+    return;
+  }
+
+  atomic<int> nextJob(0);
+  // Workers allocate actions in the arena of the caller
+  ActionArena *arena = ActionArena::current();
+  vector<thread> workers;
+  for(auto &rob : robots){
+    workers.emplace_back([&nextJob, &job, jobs, rob, arena](){
+      ActionArena::Scope scope(arena);
+      for(int i = nextJob++; i < jobs; i = nextJob++){
+	job(i, *rob);
+      }
+    });
+  }
+  for(auto &worker : workers)
+    worker.join();
+}
+
+void path::RobotPool::steal(int jobs, function<void(int, int)> job){
+  assertm(robots.size() > 0, "RobotPool is not initialized!");
+  if(robots.size() == 1 or jobs < 2){
+    for(int i=0; i<jobs; i++)
+      job(i, 0);
+    return;
+  }
+
+  int count = robots.size();
+  vector<deque<int>> queues(count);
+  vector<mutex> locks(count);
+  for(int i=0; i<jobs; i++)
+    queues[(long)i * count / jobs].push_back(i);
+
+  auto take = [&](int w, bool front, int &i){
+    lock_guard<mutex> lock(locks[w]);
+    if(queues[w].empty())
+      return false;
+    i = front ? queues[w].front() : queues[w].back();
+    front ? queues[w].pop_front() : queues[w].pop_back();
+    return true;
+  };
+
+  ActionArena *arena = ActionArena::current();
+  vector<thread> workers;
+  for(int w=0; w<count; w++){
+    workers.emplace_back([&, w](){
+      ActionArena::Scope scope(arena);
+      int i;
+      while(true){
+	bool found = take(w, true, i);
+	// No new jobs are created, all queues empty means done
+	for(int k=1; k<count and !found; k++)
+	  found = take((w + k) % count, false, i);
+	if(!found)
+	  return;
+	job(i, w);
+      }
+    });
+  }
+  for(auto &worker : workers)
+    worker.join();
+}
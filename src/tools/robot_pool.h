@@ -0,0 +1,58 @@
+#ifndef ROBOT_POOL_H
+#define ROBOT_POOL_H
+
+#include "path_tools.h"
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace path {
+
+  /////////////////////////////////////////////////////////////////////////////
+  //                                RobotPool                                //
+  /////////////////////////////////////////////////////////////////////////////
+
+  /**
+   * @brief      Set of robots that evaluate action sequences concurrently.
+   *
+   * @details    Each robot operates on a private copy of the grid map,
+   *             therefore the coverage layer (opName) can be rewritten by
+   *             every thread without interfering with the others.
+   *             With a single thread the pool only wraps the given robot
+   *             and all jobs are executed in the calling thread.
+   *             Workers use the action arena of the calling thread.
+   */
+  struct RobotPool {
+    RobotPool(){}
+    RobotPool(shared_ptr<Robot> rob, int threads);
+
+    int size(){return robots.size();}
+
+    /**
+     * @brief      Execute job(i, robot) for every i in [0, jobs).
+     *
+     * @details    Jobs are distributed dynamically over the worker threads.
+     *             The call blocks until all jobs are processed.
+     *             A job must only access data that belongs to job i and
+     *             the robot it was handed.
+     */
+    void run(int jobs, function<void(int, Robot&)> job);
+
+    /**
+     * @brief      Execute job(i, w) for every i in [0, jobs) with work stealing.
+     *
+     * @details    Every worker w starts with a contiguous block of jobs and
+     *             takes them from the front of its queue. A worker without
+     *             jobs steals from the back of the other queues, so a few
+     *             expensive jobs do not leave the remaining workers idle.
+     *             The job may use robots[w] and any other state owned by
+     *             worker w.
+     */
+    void steal(int jobs, function<void(int, int)> job);
+
+    vector<shared_ptr<Robot>> robots;
+  };
+}
+
+#endif /* ROBOT_POOL_H */
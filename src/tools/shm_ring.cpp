@@ -0,0 +1,122 @@
+#include "shm_ring.h"
+#include "debug.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+//                                  Segment                                  //
+///////////////////////////////////////////////////////////////////////////////
+
+shm::Segment::Segment(const string &name, size_t size):size(size), name(name), owner(getpid()){
+  auto fail = [&name](const string &what){
+    string msg = what + " shared memory segment " + name + ": " + strerror(errno);
+    warn(msg);
+    return runtime_error(msg);
+  };
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if(fd < 0)
+    throw fail("Cannot create");
+  if(ftruncate(fd, size) != 0){
+    auto err = fail("Cannot resize");
+    close(fd);
+    shm_unlink(name.c_str());
+    throw err;
+  }
+  void *mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if(mem == MAP_FAILED){
+    auto err = fail("Cannot map");
+    close(fd);
+    shm_unlink(name.c_str());
+    throw err;
+  }
+  close(fd);
+  data = static_cast<char*>(mem);
+}
+
+shm::Segment::~Segment(){
+  munmap(data, size);
+  if(getpid() == owner)
+    shm_unlink(name.c_str());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                                   Ring                                    //
+///////////////////////////////////////////////////////////////////////////////
+
+shm::Ring::Ring(uint32_t slots, uint32_t slotSize):slots(slots), slotSize(slotSize), enqueuePos(0), dequeuePos(0){
+  for(uint64_t i=0; i<slots; i++){
+    Cell *c = new (&cell(i)) Cell;
+    c->seq.store(i, memory_order_relaxed);
+    c->size = 0;
+  }
+}
+
+size_t shm::Ring::cellBytes(uint32_t slotSize){
+  // Keep the sequence numbers of neighboring cells on separate cache lines
+  return (sizeof(Cell) + slotSize + 63) / 64 * 64;
+}
+
+size_t shm::Ring::bytes(uint32_t slots, uint32_t slotSize){
+  return (sizeof(Ring) + 63) / 64 * 64 + slots * cellBytes(slotSize);
+}
+
+shm::Ring* shm::Ring::create(char *mem, uint32_t slots, uint32_t slotSize){
+  return new (mem) Ring(slots, slotSize);
+}
+
+shm::Ring::Cell& shm::Ring::cell(uint64_t pos){
+  char *first = reinterpret_cast<char*>(this) + (sizeof(Ring) + 63) / 64 * 64;
+  return *reinterpret_cast<Cell*>(first + (pos % slots) * cellBytes(slotSize));
+}
+
+bool shm::Ring::push(const char *data, uint32_t size){
+  if(size > slotSize)
+    return false;
+  uint64_t pos = enqueuePos.load(memory_order_relaxed);
+  Cell *c;
+  while(true){
+    c = &cell(pos);
+    int64_t diff = static_cast<int64_t>(c->seq.load(memory_order_acquire)) - static_cast<int64_t>(pos);
+    if(diff == 0){
+      // Cell is free, claim it
+      if(enqueuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+	break;
+    }else if(diff < 0){
+      return false;
+    }else{
+      pos = enqueuePos.load(memory_order_relaxed);
+    }
+  }
+  c->size = size;
+  memcpy(reinterpret_cast<char*>(c) + sizeof(Cell), data, size);
+  c->seq.store(pos + 1, memory_order_release);
+  return true;
+}
+
+bool shm::Ring::pop(vector<char> &data){
+  uint64_t pos = dequeuePos.load(memory_order_relaxed);
+  Cell *c;
+  while(true){
+    c = &cell(pos);
+    int64_t diff = static_cast<int64_t>(c->seq.load(memory_order_acquire)) - static_cast<int64_t>(pos + 1);
+    if(diff == 0){
+      // Cell holds a message, claim it
+      if(dequeuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+	break;
+    }else if(diff < 0){
+      return false;
+    }else{
+      pos = dequeuePos.load(memory_order_relaxed);
+    }
+  }
+  const char *msg = reinterpret_cast<char*>(c) + sizeof(Cell);
+  data.assign(msg, msg + c->size);
+  // Free the cell for the next round
+  c->seq.store(pos + slots, memory_order_release);
+  return true;
+}
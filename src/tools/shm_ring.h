@@ -0,0 +1,79 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace shm {
+  using namespace std;
+
+  /////////////////////////////////////////////////////////////////////////////
+  //                                 Segment                                 //
+  /////////////////////////////////////////////////////////////////////////////
+
+  /**
+   * @brief      POSIX shared memory region (shm_open + mmap).
+   *
+   * @details    The region is zero initialized and mapped shared, processes
+   *             forked afterwards use the same memory. The creating process
+   *             removes the name again on destruction.
+   *             Throws runtime_error if the region cannot be created.
+   */
+  struct Segment {
+    Segment(const string &name, size_t size);
+    Segment(const Segment&) = delete;
+    Segment& operator=(const Segment&) = delete;
+    ~Segment();
+
+    char *data = nullptr;
+    size_t size = 0;
+    string name;
+    int owner;
+  };
+
+  /////////////////////////////////////////////////////////////////////////////
+  //                                  Ring                                   //
+  /////////////////////////////////////////////////////////////////////////////
+
+  /**
+   * @brief      Bounded queue of byte messages that lives in shared memory.
+   *
+   * @details    Multiple producers and consumers (bounded MPMC queue after
+   *             Vyukov): every cell carries a sequence number, push and pop
+   *             only use atomic operations on the region itself. Therefore
+   *             processes that mapped the same region can exchange messages
+   *             without locks. Messages are copied into fixed size cells.
+   */
+  struct Ring {
+    static_assert(atomic<uint64_t>::is_always_lock_free, "Ring needs address free atomics");
+
+    // Bytes that are needed for a ring
+    static size_t bytes(uint32_t slots, uint32_t slotSize);
+    // Construct a ring in mem (before other processes use it)
+    static Ring* create(char *mem, uint32_t slots, uint32_t slotSize);
+
+    // Return false if the ring is full or the message does not fit into a cell
+    bool push(const char *data, uint32_t size);
+    bool push(const vector<char> &data){return push(data.data(), data.size());}
+    // Return false if the ring is empty
+    bool pop(vector<char> &data);
+
+    uint32_t slots;
+    uint32_t slotSize;
+  private:
+    Ring(uint32_t slots, uint32_t slotSize);
+    struct Cell {
+      atomic<uint64_t> seq;
+      uint32_t size;
+    };
+    static size_t cellBytes(uint32_t slotSize);
+    Cell& cell(uint64_t pos);
+
+    alignas(64) atomic<uint64_t> enqueuePos;
+    alignas(64) atomic<uint64_t> dequeuePos;
+  };
+}
+
+#endif /* SHM_RING_H */
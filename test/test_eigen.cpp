@@ -92,6 +92,98 @@ TEST(Eigen, diversity){
 }
 
 
+TEST(Eigen, pathSignature){
+  Matrix a = Matrix::Zero(20, 30);
+  Matrix b = Matrix::Zero(20, 30);
+  a.block(2, 3, 5, 4).setConstant(1);
+  a(19, 29) = 3;
+  b.block(4, 3, 5, 10).setConstant(2);
+  PathSignature sa(a), sb(b), empty;
+
+  EXPECT_EQ(sa.cells.size(), 21);
+  EXPECT_EQ(sa.toMatrix(), a);
+  EXPECT_NEAR(sa.distance(sb), (a - b).norm(), 1e-4);
+  EXPECT_NEAR(sb.distance(sa), (a - b).norm(), 1e-4);
+  EXPECT_NEAR(sa.distance(empty), a.norm(), 1e-4);
+  EXPECT_EQ(sa.distance(sa), 0);
+}
+
+TEST(Eigen, pairwiseDistances){
+  // Sparse and dense signatures take different paths
+  for(float density : {0.01, 0.5}){
+    Genpool pool(20);
+    Matrix layer(100, 60);
+    for(auto &gen : pool){
+      layer = (Matrix::Random(100, 60).array() + 1 < 2 * density).cast<float>() * 3;
+      gen.signature = make_shared<PathSignature>(layer);
+    }
+    pool.push_back(genome());
+
+    Eigen::MatrixXd D = pairwiseDistances(pool);
+    Eigen::VectorXf sums = Eigen::VectorXf::Zero(pool.size());
+    calDistanceMat(pool, sums);
+    PathSignature empty;
+    for(int i=0; i<pool.size(); i++){
+      float sum = 0;
+      for(int j=0; j<pool.size(); j++){
+	auto &a = pool[i].signature ? *pool[i].signature : empty;
+	auto &b = pool[j].signature ? *pool[j].signature : empty;
+	EXPECT_NEAR(D(i, j), a.distance(b), 1e-3);
+	sum += a.distance(b);
+      }
+      EXPECT_NEAR(sums[i], sum, 1e-2);
+      EXPECT_NEAR(pool[i].diversityFactor, sum, 1e-2);
+    }
+  }
+}
+
+TEST(Eigen, sketchDiversity){
+  Genpool pool(50);
+  for(auto &gen : pool){
+    Matrix layer = (Matrix::Random(100, 100).array() > 0.8).cast<float>();
+    auto sig = make_shared<PathSignature>(layer);
+    sig->project(256);
+    gen.signature = sig;
+  }
+  Eigen::VectorXf exact = Eigen::VectorXf::Zero(pool.size());
+  calDistanceMat(pool, exact);
+
+  rng::Philox generator(42);
+  for(int samples : {0, 10}){
+    Eigen::VectorXf approx = Eigen::VectorXf::Zero(pool.size());
+    float error = 1;
+    calDistanceSketch(pool, approx, samples, generator, error);
+    EXPECT_LT(error, 0.1);
+    EXPECT_NEAR(approx.mean() / exact.mean(), 1, 0.1);
+  }
+}
+
+TEST(Eigen, incrementalDiversity){
+  auto randomGen = [](){
+    genome gen;
+    gen.signature = make_shared<PathSignature>((Matrix::Random(40, 40).array() > 0.7).cast<float>());
+    return gen;
+  };
+  Genpool pool;
+  for(int i=0; i<30; i++)
+    pool.push_back(randomGen());
+  DiversityMatrix divMat;
+  for(int iter=0; iter<5; iter++){
+    Eigen::VectorXf exact = Eigen::VectorXf::Zero(pool.size());
+    Eigen::VectorXf incremental = Eigen::VectorXf::Zero(pool.size());
+    calDistanceMat(pool, exact);
+    divMat.update(pool, incremental);
+    EXPECT_TRUE(incremental.isApprox(exact, 1e-4));
+    EXPECT_EQ(divMat.computedRows, iter == 0 ? 30 : 3);
+
+    // Replace some gens, duplicate survivors
+    pool.erase(pool.begin(), pool.begin() + 4);
+    for(int i=0; i<3; i++)
+      pool.push_back(randomGen());
+    pool.push_back(pool.front());
+  }
+}
+
 TEST(SaveImages, MapScenarios){
   executionConfig eConf("../../../src/ros_optimizer/test/config.yml");
   mapgen::saveMap(to_string(eConf.mapType), eConf.gmap, "obstacle", 1);
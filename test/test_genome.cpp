@@ -314,6 +314,269 @@ TEST(TimeComponents, Evaluation){
   rob.evaluateActions(gen.actions);
 }
 
+TEST(Fitness, parallelEvaluation){
+  // Both configurations use the same seed and thus generate the same population
+  executionConfig eConf("../../../src/ros_optimizer/test/config.yml");
+  executionConfig eConfPar("../../../src/ros_optimizer/test/config.yml");
+  eConf.initIndividuals = eConfPar.initIndividuals = 50;
+  InitStrategy init;
+  FitnessStrategy fit;
+  Genpool pool, poolPar;
+  init(pool, eConf);
+  init(poolPar, eConfPar);
+
+  auto rob = make_shared<PolyRobot>(PolyRobot(eConf.rob_conf, eConf.gmap, eConf.obstacleName));
+  auto robPar = make_shared<PolyRobot>(PolyRobot(eConfPar.rob_conf, eConfPar.gmap, eConfPar.obstacleName));
+  RobotPool robots(robPar, 4);
+  ASSERT_EQ(robots.size(), 4);
+
+  fit(pool, *rob, eConf);
+  fit(poolPar, robots, eConfPar);
+
+  ASSERT_EQ(pool.size(), poolPar.size());
+  for(int i=0; i<pool.size(); i++){
+    EXPECT_EQ(pool[i].fitness, poolPar[i].fitness);
+    EXPECT_EQ(pool[i].traveledDist, poolPar[i].traveledDist);
+    EXPECT_EQ(pool[i].cross, poolPar[i].cross);
+  }
+  EXPECT_EQ(eConf.fitnessAvg, eConfPar.fitnessAvg);
+}
+
+TEST(RobotPool, workStealing){
+  executionConfig eConf("../../../src/ros_optimizer/test/config.yml");
+  auto rob = make_shared<PolyRobot>(PolyRobot(eConf.rob_conf, eConf.gmap, eConf.obstacleName));
+  RobotPool robots(rob, 4);
+  // The first worker gets the expensive jobs, the others have to steal
+  vector<atomic<int>> calls(40);
+  robots.steal(calls.size(), [&](int i, int w){
+    ASSERT_TRUE(w >= 0 and w < robots.size());
+    if(i < 10)
+      this_thread::sleep_for(chrono::milliseconds(5));
+    calls[i]++;
+  });
+  for(auto &c : calls)
+    EXPECT_EQ(c, 1);
+}
+
+TEST(Fitness, incrementalEvaluation){
+  executionConfig eConf("../../../src/ros_optimizer/test/config.yml");
+  executionConfig eConfInc("../../../src/ros_optimizer/test/config.yml");
+  eConf.initIndividuals = eConfInc.initIndividuals = 50;
+  InitStrategy init;
+  FitnessStrategy fit;
+  Genpool pool, poolInc;
+  init(pool, eConf);
+  init(poolInc, eConfInc);
+
+  auto rob = make_shared<PolyRobot>(PolyRobot(eConf.rob_conf, eConf.gmap, eConf.obstacleName));
+  auto robInc = make_shared<PolyRobot>(PolyRobot(eConfInc.rob_conf, eConfInc.gmap, eConfInc.obstacleName));
+  rob->incremental = false;
+  ASSERT_TRUE(robInc->incremental);
+
+  fit(pool, *rob, eConf);
+  fit(poolInc, *robInc, eConfInc);
+
+  // Change the second half of every path, the prefix should be restored
+  for(auto *p : {&pool, &poolInc}){
+    for(auto &gen : *p){
+      auto &pa = gen.actions[gen.actions.size()/2];
+      pa->mod_config[PAP::Distance] *= 0.5;
+      pa->modified = true;
+    }
+    reverse(p->begin(), p->end());
+  }
+  fit(pool, *rob, eConf);
+  fit(poolInc, *robInc, eConfInc);
+
+  ASSERT_EQ(pool.size(), poolInc.size());
+  for(int i=0; i<pool.size(); i++){
+    EXPECT_EQ(pool[i].fitness, poolInc[i].fitness);
+    EXPECT_EQ(pool[i].traveledDist, poolInc[i].traveledDist);
+    EXPECT_EQ(pool[i].cross, poolInc[i].cross);
+  }
+  EXPECT_EQ(eConf.fitnessAvg, eConfInc.fitnessAvg);
+  rob->syncCoverage();
+  robInc->syncCoverage();
+  EXPECT_TRUE((*rob->pmap)[rob->opName].isApprox((*robInc->pmap)[robInc->opName]));
+}
+
+TEST(Fitness, evaluationCache){
+  executionConfig eConf("../../../src/ros_optimizer/test/config.yml");
+  eConf.initIndividuals = 50;
+  eConf.fitnessCacheSize = 100;
+  InitStrategy init;
+  FitnessStrategy fit;
+  Genpool pool;
+  init(pool, eConf);
+  auto rob = make_shared<PolyRobot>(PolyRobot(eConf.rob_conf, eConf.gmap, eConf.obstacleName));
+
+  fit(pool, *rob, eConf);
+  EXPECT_EQ(eConf.cacheHits, 0);
+  EXPECT_EQ(fit.cache.size(), 50);
+  vector<float> fitness;
+  for(auto &gen : pool)
+    fitness.push_back(gen.fitness);
+
+  // Unchanged gens are restored, modified gens are executed again
+  pool[0].actions[1]->modified = true;
+  int misses = eConf.cacheMisses;
+  fit(pool, *rob, eConf);
+  EXPECT_EQ(eConf.cacheHits, 49);
+  EXPECT_EQ(eConf.cacheMisses, misses + 1);
+  for(int i=0; i<pool.size(); i++)
+    EXPECT_FLOAT_EQ(pool[i].fitness, fitness[i]);
+
+  // A key collision is a miss
+  genome other = pool[2];
+  fit.cache.insert(pool[1], other.structuralHash(), 100);
+  EXPECT_FALSE(fit.cache.lookup(other, other.structuralHash()));
+  EXPECT_FLOAT_EQ(other.fitness, fitness[2]);
+  EXPECT_TRUE(fit.cache.lookup(pool[1], other.structuralHash()));
+
+  // Capacity is respected
+  fit.cache.insert(pool[0], 42, 10);
+  EXPECT_EQ(fit.cache.size(), 10);
+}
+
+TEST(Selection, tournament){
+  executionConfig eConf("../../../src/ros_optimizer/test/config.yml");
+  Genpool pool;
+  for(int i=0; i<20; i++)
+    pool.push_back(genome((i * 7) % 20));
+  vector<int> ids;
+  for(auto &gen : pool)
+    ids.push_back(gen.id);
+
+  TournamentSelection selection;
+  vector<int> parents;
+  eConf.tournamentSize = pool.size();
+  EXPECT_TRUE(selection.selectIndices(pool, 10, parents, eConf));
+  EXPECT_EQ(parents.size(), 10);
+  for(int idx : parents)
+    EXPECT_EQ(pool[idx].fitness, 19);
+
+  // The pool is neither reordered nor copied
+  eConf.tournamentSize = 3;
+  for(int i=0; i<100; i++)
+    EXPECT_GE(pool[selection.tournamentIndex(pool, eConf)].fitness, 2);
+  for(int i=0; i<pool.size(); i++)
+    EXPECT_EQ(pool[i].id, ids[i]);
+}
+
+TEST(Selection, rouletteWheel){
+  executionConfig eConf("../../../src/ros_optimizer/test/config.yml");
+  Genpool pool;
+  for(int i=0; i<10; i++)
+    pool.push_back(genome(i));
+
+  RWS rws;
+  vector<int> parents;
+  eConf.selectSUS = false;
+  EXPECT_TRUE(rws.selectIndices(pool, 1000, parents, eConf));
+  EXPECT_EQ(count(parents.begin(), parents.end(), 0), 0);
+
+  // Equally spaced pointers hit each gen proportional to its fitness
+  eConf.selectSUS = true;
+  EXPECT_TRUE(rws.selectIndices(pool, 45, parents, eConf));
+  for(int i=0; i<10; i++)
+    EXPECT_EQ(count(parents.begin(), parents.end(), i), i);
+
+  RankedRWS ranked;
+  EXPECT_TRUE(ranked.selectIndices(pool, 100, parents, eConf));
+  for(int idx : parents){
+    EXPECT_GE(idx, 0);
+    EXPECT_LT(idx, pool.size());
+  }
+}
+
+TEST(Crossover, sharedActions){
+  executionConfig eConf("../../../src/ros_optimizer/test/config.yml");
+  eConf.initIndividuals = 2;
+  InitStrategy init;
+  FitnessStrategy fit;
+  Genpool pool;
+  init(pool, eConf);
+  auto rob = make_shared<PolyRobot>(PolyRobot(eConf.rob_conf, eConf.gmap, eConf.obstacleName));
+  fit(pool, *rob, eConf);
+  ASSERT_GT(pool[0].actions.size(), 6);
+  ASSERT_GT(pool[1].actions.size(), 6);
+  vector<ActionWPs> before;
+  for(auto &pa : pool[0].actions)
+    before.push_back(pa->wps);
+
+  DualPointCrossover cross;
+  int sIdx[2] = {3, 2};
+  int len[2] = {2, 2};
+  genome child = cross.getChild(pool[0].actions, pool[1].actions, sIdx, len, false);
+  ASSERT_EQ(child.actions.size(), pool[0].actions.size());
+  // Unchanged runs are not copied
+  EXPECT_EQ(child.actions[0], pool[0].actions[0]);
+  EXPECT_EQ(child.actions[1], pool[0].actions[1]);
+  EXPECT_NE(child.actions[2], pool[0].actions[2]);
+
+  // Only the selected variants are built
+  int lenMid[2] = {2, 3};
+  EXPECT_EQ(cross.getChildren(pool[0].actions, pool[1].actions, sIdx, lenMid, 1).size(), 1);
+  auto both = cross.getChildren(pool[0].actions, pool[1].actions, sIdx, lenMid, 2);
+  ASSERT_EQ(both.size(), 2);
+  EXPECT_EQ(both[1].actions[4], pool[1].actions[3]);
+  EXPECT_NE(both[0].actions[4], pool[1].actions[3]);
+  EXPECT_EQ(both[0].actions[0], both[1].actions[0]);
+
+  // Neither validation nor evaluation of the child changes the parent
+  fit.evaluateGen(child, *rob, eConf);
+  for(int i=0; i<before.size(); i++)
+    EXPECT_EQ(pool[0].actions[i]->wps, before[i]);
+}
+
+TEST(Crossover, failedPairs){
+  executionConfig eConf("../../../src/ros_optimizer/test/config.yml");
+  eConf.crossoverProba = 0;
+  genome a(1), b(2), c(3);
+  SelectionPool selPool = {{a, b}, {b, c}, {a, c}, {c, c}};
+  Genpool nextPool;
+  DualPointCrossover cross;
+  cross(selPool, nextPool, eConf);
+  // Parents of failed pairs are passed on once
+  EXPECT_EQ(eConf.crossFailed, 4);
+  ASSERT_EQ(nextPool.size(), 3);
+  EXPECT_EQ(nextPool[0], a);
+  EXPECT_EQ(nextPool[1], b);
+  EXPECT_EQ(nextPool[2], c);
+
+  // Gens that already enter the next generation (elites) are not added again
+  Genpool elites = {b};
+  nextPool.clear();
+  cross(selPool, nextPool, eConf, &elites);
+  ASSERT_EQ(nextPool.size(), 2);
+  EXPECT_EQ(nextPool[0], a);
+  EXPECT_EQ(nextPool[1], c);
+}
+
+TEST(PoolMembers, insert){
+  genome a(1), b(2);
+  Genpool pool = {a};
+  PoolMembers members(pool, 4);
+  EXPECT_TRUE(members.contains(a));
+  EXPECT_FALSE(members.contains(b));
+  EXPECT_FALSE(members.insert(a));
+  EXPECT_TRUE(members.insert(b));
+  EXPECT_FALSE(members.insert(b));
+  // Copies keep the id
+  genome copy = b;
+  EXPECT_FALSE(members.insert(copy));
+  ASSERT_EQ(pool.size(), 2);
+  EXPECT_EQ(pool[0], a);
+  EXPECT_EQ(pool[1], b);
+
+  // Tracked gens are known but not appended
+  genome c(3);
+  members.track({c});
+  EXPECT_TRUE(members.contains(c));
+  EXPECT_FALSE(members.insert(c));
+  EXPECT_EQ(pool.size(), 2);
+}
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   // ros::init(argc, argv, "tester");
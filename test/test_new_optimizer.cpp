@@ -4,7 +4,7 @@
 // #include <opencv2/core/eigen.hpp>
 #include <opencv2/opencv.hpp>
 // #include "../src/optimizer/grid_search.h"
-#include "../src/optimizer/optimizer.h"
+#include "../src/optimizer/island.h"
 #include <yaml-cpp/yaml.h>
 
 
@@ -48,25 +48,242 @@ TEST(Optimizer, standardConfig){
 		     make_shared<op::FitnessStrategy>(op::FitnessStrategy()),
 		     eConf);
 
-  if(eConf.scenario == 0)  // elitist selection
-    opti.optimizePath(eConf.printInfo);
-  else
-    opti.optimizePath_Turn_RWS(eConf.printInfo);
+  opti.optimize(eConf.printInfo);
 
 
 
   if(eConf.retrain){
     mapgen::emulateCoveredMapSegment(opti.eConf.gmap, eConf.start);
     opti.eConf.maxIterations = eConf.retrain;
-    if(eConf.scenario == 0)  // elitist selection
-      opti.optimizePath(eConf.printInfo);
-    else
-      opti.optimizePath_Turn_RWS(eConf.printInfo);
+    opti.optimize(eConf.printInfo);
 
   }
 
 }
 
+TEST(Optimizer, steadyState){
+  executionConfig eConf("../../../src/ros_optimizer/test/config.yml");
+  eConf.scenario = 4;
+  eConf.evalThreads = 3;
+  eConf.maxIterations = 5;
+  eConf.initIndividuals = 30;
+  eConf.visualize = eConf.printInfo = eConf.takeSnapshot = false;
+  op::Optimizer opti(
+		     make_shared<op::InitStrategy>(op::InitStrategy()),
+		     make_shared<op::SelectionStrategy>(op::SelectionStrategy()),
+		     make_shared<op::DualPointCrossover>(op::DualPointCrossover()),
+		     make_shared<op::MutationStrategy>(op::MutationStrategy()),
+		     make_shared<op::FitnessStrategy>(op::FitnessStrategy()),
+		     eConf);
+
+  // Called once per iteration with the shared population
+  vector<float> best;
+  opti.migration = [&](Genpool &population, executionConfig &conf){
+    EXPECT_EQ(population.size(), eConf.initIndividuals);
+    best.push_back(max_element(population.begin(), population.end())->fitness);
+  };
+  opti.optimize(false);
+
+  EXPECT_EQ(opti.pool.size(), eConf.initIndividuals);
+  ASSERT_GT(best.size(), 1);
+  for(int i=1; i<best.size(); i++)
+    EXPECT_GE(best[i], best[i-1]);
+  EXPECT_GT(opti.eConf.evaluations, 0);
+}
+
+TEST(Optimizer, steadyStateScale){
+  executionConfig eConf("../../../src/ros_optimizer/test/config.yml");
+  eConf.scenario = 4;
+  eConf.fitSselect = 1;
+  eConf.evalThreads = 2;
+  eConf.maxIterations = 3;
+  eConf.initIndividuals = 30;
+  eConf.retrain = 0;
+  eConf.visualize = eConf.printInfo = eConf.takeSnapshot = false;
+  op::Optimizer opti(
+		     make_shared<op::InitStrategy>(op::InitStrategy()),
+		     make_shared<op::SelectionStrategy>(op::SelectionStrategy()),
+		     make_shared<op::DualPointCrossover>(op::DualPointCrossover()),
+		     make_shared<op::MutationStrategy>(op::MutationStrategy()),
+		     make_shared<op::FitnessStrategy>(op::FitnessStrategy()),
+		     eConf);
+  opti.optimize(false);
+
+  // Initial gens and children carry the fitness of a single evaluation (no pool bias)
+  FitnessRotationBias fit;
+  auto rob = opti.rob->clone(make_shared<GridMap>(*opti.rob->pmap));
+  ASSERT_EQ(opti.pool.size(), eConf.initIndividuals);
+  for(auto &gen : opti.pool){
+    genome copy = gen;
+    fit.evaluateGen(copy, *rob, opti.eConf);
+    EXPECT_NEAR(copy.fitness, gen.fitness, 1e-5 * max(1.0f, gen.fitness));
+  }
+}
+
+TEST(Optimizer, threadIndependent){
+  executionConfig eConf("../../../src/ros_optimizer/test/config.yml");
+  eConf.scenario = 0;
+  eConf.maxIterations = 4;
+  eConf.initIndividuals = 30;
+  eConf.retrain = 0;
+  eConf.visualize = eConf.printInfo = eConf.takeSnapshot = false;
+  // All runs start on a copy of the same map
+  auto run = [&eConf](int threads, int seed){
+    executionConfig conf = eConf;
+    conf.evalThreads = threads;
+    conf.gmap = make_shared<GridMap>(*eConf.gmap);
+    conf.fitnessStr = make_shared<std::ostringstream>(std::ostringstream());
+    conf.logStr = make_shared<std::ostringstream>(std::ostringstream());
+    conf.generator.seed(seed);
+    auto opti = make_shared<op::Optimizer>(
+		     make_shared<op::InitStrategy>(op::InitStrategy()),
+		     make_shared<op::SelectionStrategy>(op::SelectionStrategy()),
+		     make_shared<op::DualPointCrossover>(op::DualPointCrossover()),
+		     make_shared<op::MutationStrategy>(op::MutationStrategy()),
+		     make_shared<op::FitnessStrategy>(op::FitnessStrategy()),
+		     conf);
+    opti->optimize(false);
+    return opti;
+  };
+  auto serial = run(1, eConf.genSeed);
+  auto parallel = run(4, eConf.genSeed);
+
+  // Streams are keyed by iteration, individual and operator, not by the worker
+  ASSERT_EQ(serial->pool.size(), parallel->pool.size());
+  for(int i=0; i<serial->pool.size(); i++)
+    EXPECT_EQ(serial->pool[i].fitness, parallel->pool[i].fitness);
+  EXPECT_EQ(serial->eConf.currentIter, parallel->eConf.currentIter);
+  EXPECT_EQ(serial->eConf.best.fitness, parallel->eConf.best.fitness);
+  ASSERT_EQ(serial->eConf.best.actions.size(), parallel->eConf.best.actions.size());
+  for(int i=0; i<serial->eConf.best.actions.size(); i++)
+    EXPECT_EQ(serial->eConf.best.actions[i]->wps, parallel->eConf.best.actions[i]->wps);
+
+  // Another seed selects other streams
+  auto other = run(4, eConf.genSeed + 1);
+  bool differs = other->pool.size() != serial->pool.size();
+  for(int i=0; i<serial->pool.size() and !differs; i++)
+    differs = other->pool[i].fitness != serial->pool[i].fitness;
+  EXPECT_TRUE(differs);
+}
+
+TEST(Island, mailbox){
+  Mailbox box;
+  vector<thread> senders;
+  for(int t=0; t<4; t++)
+    senders.emplace_back([&box](){
+      for(int i=0; i<100; i++)
+	box.post(genome(i));
+    });
+  for(auto &t : senders)
+    t.join();
+
+  Genpool arrived = box.collect();
+  ASSERT_EQ(arrived.size(), 400);
+  set<int> ids;
+  for(auto &gen : arrived)
+    ids.insert(gen.id);
+  EXPECT_EQ(ids.size(), 400);
+  EXPECT_TRUE(box.collect().empty());
+
+  // Gens of one sender keep their order
+  box.post(genome(1));
+  box.post(genome(2));
+  arrived = box.collect();
+  EXPECT_EQ(arrived[0].fitness, 1);
+  EXPECT_EQ(arrived[1].fitness, 2);
+}
+
+TEST(Island, ownArenas){
+  executionConfig eConf("../../../src/ros_optimizer/test/config.yml");
+  eConf.scenario = 0;
+  eConf.islands = 2;
+  eConf.maxIterations = 4;
+  eConf.initIndividuals = 20;
+  eConf.migrationInterval = 1;
+  eConf.retrain = 0;
+  eConf.actionArena = true;
+  eConf.visualize = eConf.printInfo = eConf.takeSnapshot = false;
+  IslandModel model(eConf, [](executionConfig conf){
+    return make_shared<op::Optimizer>(
+		     make_shared<op::InitStrategy>(op::InitStrategy()),
+		     make_shared<op::SelectionStrategy>(op::SelectionStrategy()),
+		     make_shared<op::DualPointCrossover>(op::DualPointCrossover()),
+		     make_shared<op::MutationStrategy>(op::MutationStrategy()),
+		     make_shared<op::FitnessStrategy>(op::FitnessStrategy()),
+		     conf);
+  });
+
+  // Both islands are alive at the same time, their arenas have to differ
+  vector<int> calls(model.size(), 0);
+  for(int i=0; i<model.size(); i++){
+    model.islands.push_back(model.createIsland(i));
+    auto migrate = model.islands[i]->migration;
+    model.islands[i]->migration = [&model, &calls, migrate, i](Genpool &pool, executionConfig &conf){
+      ActionArena *own = model.islands[i]->arena.get();
+      EXPECT_NE(own, nullptr);
+      EXPECT_EQ(ActionArena::current(), own);
+      if(conf.currentIter > 0){
+	EXPECT_GT(conf.actionAllocs, 0);
+      }
+      calls[i]++;
+      migrate(pool, conf);
+    };
+  }
+  model.run(false);
+
+  for(int i=0; i<model.size(); i++)
+    EXPECT_GT(calls[i], 1);
+  EXPECT_NE(model.islands[0]->arena, model.islands[1]->arena);
+  EXPECT_GT(model.immigrants[0] + model.immigrants[1], 0);
+}
+
+TEST(Optimizer, arenaCompaction){
+  executionConfig eConf("../../../src/ros_optimizer/test/config.yml");
+  eConf.scenario = 0;
+  eConf.maxIterations = 6;
+  eConf.initIndividuals = 20;
+  eConf.retrain = 0;
+  eConf.actionArena = true;
+  eConf.visualize = eConf.printInfo = eConf.takeSnapshot = false;
+  // Arenas used by the generations of one run
+  auto run = [&eConf](float below, int every){
+    executionConfig conf = eConf;
+    conf.arenaCompactBelow = below;
+    conf.arenaCompactEvery = every;
+    auto opti = make_shared<op::Optimizer>(
+		     make_shared<op::InitStrategy>(op::InitStrategy()),
+		     make_shared<op::SelectionStrategy>(op::SelectionStrategy()),
+		     make_shared<op::DualPointCrossover>(op::DualPointCrossover()),
+		     make_shared<op::MutationStrategy>(op::MutationStrategy()),
+		     make_shared<op::FitnessStrategy>(op::FitnessStrategy()),
+		     conf);
+    vector<ActionArena*> arenas;
+    opti->migration = [&arenas, opti](Genpool &pool, executionConfig &conf){
+      arenas.push_back(opti->arena.get());
+      if(conf.currentIter > 0){
+	EXPECT_GT(conf.actionAllocs, 0);
+	EXPECT_GT(conf.actionRetained, 0);
+      }
+      // Waypoints of the population live in the arena
+      for(auto &pa : pool[0].actions)
+	EXPECT_NE(pa->wps.get_allocator().arena, nullptr);
+    };
+    opti->optimize(false);
+    opti->migration = nullptr;
+    // The old arena is alive while the next one is created, addresses of consecutive arenas differ
+    int changes = 0;
+    for(int i=1; i<arenas.size(); i++)
+      changes += arenas[i] != arenas[i-1];
+    return changes;
+  };
+  // Never below the threshold: one arena for the whole run
+  EXPECT_EQ(run(0, 0), 0);
+  // Compacted every generation
+  EXPECT_GT(run(0, 1), 2);
+  // Always below the threshold
+  EXPECT_GT(run(1.1, 0), 2);
+}
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   // ros::init(argc, argv, "tester");
@@ -7,6 +7,8 @@
 #include <grid_map_cv/GridMapCvConverter.hpp>
 #include "../src/tools/pa_serializer.h"
 #include "../src/tools/genome_tools.h"
+#include "../src/tools/action_table.h"
+#include "../src/tools/shm_ring.h"
 #include "grid_map_core/iterators/GridMapIterator.hpp"
 #include "grid_map_core/iterators/LineIterator.hpp"
 
@@ -23,6 +25,28 @@ using namespace grid_map;
 //   EXPECT_EQ(conf1[PAP::Angle], 42);
 // }
 
+TEST(HelperFunctions, enumMap){
+  PA_config conf = {{PAP::Distance, 42}, {PAP::Angle, 40}};
+  EXPECT_EQ(conf.size(), 2);
+  EXPECT_EQ(conf.count(PAP::StepCount), 0);
+  EXPECT_TRUE(conf.find(PAP::StepCount) == conf.end());
+
+  // Insert keeps existing values
+  EXPECT_FALSE(conf.insert({PAP::Angle, 0}).second);
+  EXPECT_EQ(conf[PAP::Angle], 40);
+  EXPECT_TRUE(conf.insert({PAP::StepCount, 1}).second);
+
+  // Iteration in key order over inserted keys only
+  vector<PAP> keys;
+  for(auto &[key, value] : conf)
+    keys.push_back(key);
+  EXPECT_EQ(keys, vector<PAP>({PAP::Angle, PAP::Distance, PAP::StepCount}));
+
+  PA_config copy(conf);
+  EXPECT_TRUE(copy == conf);
+  copy.erase(PAP::StepCount);
+  EXPECT_FALSE(copy == conf);
+}
 
 TEST(HelperFunctions, copyAction){
   StartAction sa(Position(42,42));
@@ -404,6 +428,200 @@ TEST(Serializer, writePoolToFile){
 
 }
 
+TEST(ActionTable, conversion){
+  PAs actions;
+  actions.push_back(make_shared<StartAction>(StartAction(Position(1, 2))));
+  for(int i=0; i<10; i++){
+    auto aa = make_shared<AheadAction>(AheadAction(PAT::CAhead, {{PAP::Angle, 30*i}, {PAP::Distance, 1 + i}}));
+    aa->generateWPs(actions.back()->wps.back());
+    aa->c_config[Counter::StepCount] = i;
+    aa->c_config[Counter::CoverdCount] = 2*i;
+    actions.push_back(aa);
+  }
+  actions.push_back(make_shared<EndAction>(EndAction({actions.back()->wps.back()})));
+
+  ActionTable table(actions);
+  ASSERT_EQ(table.size(), actions.size());
+  ActionTable part;
+  part.append(table, 3, 7);
+  EXPECT_EQ(part.size(), 4);
+  EXPECT_EQ(part.start[0], table.start[3]);
+
+  PAs restored = table.toActions();
+  ASSERT_EQ(restored.size(), actions.size());
+  for(int i=0; i<actions.size(); i++){
+    EXPECT_EQ(restored[i]->type, actions[i]->type);
+    EXPECT_EQ(restored[i]->wps.front(), actions[i]->wps.front());
+    EXPECT_EQ(restored[i]->c_config, actions[i]->c_config);
+    if(actions[i]->type != PAT::End){
+      EXPECT_EQ(restored[i]->wps.back(), actions[i]->wps.back());
+      EXPECT_EQ(restored[i]->mod_config[PAP::Distance], actions[i]->mod_config[PAP::Distance]);
+    }
+  }
+}
+
+TEST(ActionArena, generationLifetime){
+  int arenas = ActionArena::instances;
+  auto arena = ActionArena::create();
+  shared_ptr<PathAction> elite;
+  {
+    ActionArena::Scope scope(arena.get());
+    elite = newAction<AheadAction>(AheadAction(PAT::CAhead, {{PAP::Angle, 90}, {PAP::Distance, 2}}));
+    PAs actions;
+    for(int i=0; i<1000; i++)
+      actions.push_back(newAction<StartAction>(StartAction(Position(i, 0))));
+    EXPECT_EQ(actions.back()->wps.front(), Position(999, 0));
+    // Threads bump in blocks of their own
+    thread worker([&arena](){
+      ActionArena::Scope scope(arena.get());
+      for(int i=0; i<100; i++)
+	newAction<StartAction>(StartAction(Position(i, 0)));
+    });
+    worker.join();
+    // Every StartAction also keeps its waypoint in the arena
+    EXPECT_EQ(arena->allocations(), 2201);
+    EXPECT_EQ(arena->objects(), 2001);
+  }
+  EXPECT_EQ(ActionArena::current(), nullptr);
+  EXPECT_EQ(arena->objects(), 1);
+
+  // The survivor is copied into the next arena, the old one is released at once
+  auto next = ActionArena::create();
+  {
+    ActionArena::Scope scope(next.get());
+    elite = elite->clone();
+  }
+  arena.reset();
+  EXPECT_EQ(ActionArena::instances, arenas + 1);
+  EXPECT_EQ(elite->mod_config[PAP::Angle], 90);
+  EXPECT_EQ(next->objects(), 1);
+
+  // An action that escaped the compaction keeps its arena alive
+  {
+    ActionArena::Scope scope(next.get());
+    elite = newAction<AheadAction>(*dynamic_pointer_cast<AheadAction>(elite));
+  }
+  next.reset();
+  EXPECT_EQ(ActionArena::instances, arenas + 1);
+  elite.reset();
+  EXPECT_EQ(ActionArena::instances, arenas);
+}
+
+TEST(ActionArena, waypoints){
+  auto arena = ActionArena::create();
+  shared_ptr<PathAction> pa;
+  {
+    ActionArena::Scope scope(arena.get());
+    pa = newAction<AheadAction>(AheadAction(PAT::CAhead, {{PAP::Angle, 90}, {PAP::Distance, 2}}));
+    pa->generateWPs(Position(0, 0));
+  }
+  EXPECT_EQ(pa->wps.get_allocator().arena, arena.get());
+  EXPECT_EQ(arena->objects(), 2);
+
+  // A clone takes its waypoints into the arena of the calling thread
+  auto next = ActionArena::create();
+  shared_ptr<PathAction> copy;
+  {
+    ActionArena::Scope scope(next.get());
+    copy = pa->clone();
+  }
+  EXPECT_EQ(copy->wps, pa->wps);
+  EXPECT_EQ(copy->wps.get_allocator().arena, next.get());
+  EXPECT_EQ(next->objects(), 2);
+
+  // Without an arena the heap is used
+  auto heap = copy->clone();
+  EXPECT_EQ(heap->wps.get_allocator().arena, nullptr);
+  EXPECT_EQ(heap->wps, pa->wps);
+  EXPECT_EQ(next->objects(), 2);
+}
+
+TEST(Genome, copyOnWrite){
+  genome_tools::genome gen(PAs{newAction<StartAction>(StartAction(Position(0, 0))),
+		 newAction<AheadAction>(AheadAction(PAT::CAhead, {{PAP::Angle, 90}, {PAP::Distance, 2}})),
+		 newAction<EndAction>(EndAction({Position(0, 2)}))});
+  PathAction *unique = gen.actions[0].get();
+  genome_tools::genome copy = gen;
+  EXPECT_EQ(copy.actions[1], gen.actions[1]);
+
+  // Only the touched action is copied
+  copy.detach(next(copy.actions.begin(), 1));
+  copy.actions[1]->mod_config[PAP::Angle] = 45;
+  EXPECT_NE(copy.actions[1], gen.actions[1]);
+  EXPECT_TRUE(dynamic_pointer_cast<AheadAction>(copy.actions[1]));
+  EXPECT_EQ(gen.actions[1]->mod_config[PAP::Angle], 90);
+  EXPECT_EQ(copy.actions[2], gen.actions[2]);
+
+  // Actions that are not shared are kept
+  copy = genome_tools::genome();
+  gen.detach();
+  EXPECT_EQ(gen.actions[0].get(), unique);
+}
+
+TEST(Serializer, binaryGenome){
+  genome_tools::genome gen(PAs{newAction<StartAction>(StartAction(Position(0.1, 0.3))),
+		 newAction<AheadAction>(AheadAction(PAT::CAhead, {{PAP::Angle, 90}, {PAP::Distance, 2}})),
+		 newAction<EndAction>(EndAction({Position(0.1, 2.3)}))});
+  gen.actions[1]->wps = {Position(0.1, 0.3), Position(0.1, 2.3)};
+  gen.actions[1]->c_config[Counter::StepCount] = 7;
+  gen.fitness = 0.75;
+  gen.finalCoverage = 0.5;
+  auto sig = make_shared<genome_tools::PathSignature>();
+  sig->rows = sig->cols = 4;
+  sig->cells = {1, 5};
+  sig->values = {1, 2};
+  gen.signature = sig;
+
+  vector<char> buffer;
+  pa_serializer::encodeGenome(gen, buffer);
+  genome_tools::genome res;
+  ASSERT_TRUE(pa_serializer::decodeGenome(buffer.data(), buffer.size(), res));
+  EXPECT_NE(res.id, gen.id);
+  EXPECT_EQ(res.fitness, gen.fitness);
+  EXPECT_EQ(res.finalCoverage, gen.finalCoverage);
+  ASSERT_EQ(res.actions.size(), 3);
+  EXPECT_EQ(res.actions[1]->wps, gen.actions[1]->wps);
+  EXPECT_EQ(res.actions[1]->c_config[Counter::StepCount], 7);
+  EXPECT_EQ(res.signature->cells, sig->cells);
+  EXPECT_FALSE(pa_serializer::decodeGenome(buffer.data(), buffer.size() - 1, res));
+}
+
+TEST(Philox, streams){
+  // Known answer of Philox4x32-10 (Random123)
+  auto zero = rng::Philox::block({0, 0, 0, 0}, {0, 0});
+  EXPECT_EQ(zero, (array<uint32_t, 4>{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+
+  // A stream yields the same numbers no matter what was drawn before
+  rng::Philox a(42), b(42);
+  b.discard(1000);
+  a.stream(3, 7, 2);
+  b.stream(3, 7, 2);
+  for(int i=0; i<10; i++)
+    EXPECT_EQ(a(), b());
+  b.stream(3, 8, 2);
+  a.stream(3, 7, 2);
+  EXPECT_NE(a(), b());
+}
+
+TEST(SharedMemory, ring){
+  shm::Segment segment("/opti_test_" + to_string(getpid()), shm::Ring::bytes(2, 8));
+  auto ring = shm::Ring::create(segment.data, 2, 8);
+  vector<char> msg;
+  EXPECT_FALSE(ring->pop(msg));
+  EXPECT_TRUE(ring->push(vector<char>{'a'}));
+  EXPECT_TRUE(ring->push(vector<char>{'b', 'c'}));
+  // Full and too large messages are rejected
+  EXPECT_FALSE(ring->push(vector<char>{'d'}));
+  EXPECT_FALSE(ring->push(vector<char>(9, 'e')));
+  ASSERT_TRUE(ring->pop(msg));
+  EXPECT_EQ(msg, vector<char>{'a'});
+  EXPECT_TRUE(ring->push(vector<char>{'d'}));
+  ASSERT_TRUE(ring->pop(msg));
+  EXPECT_EQ(msg, (vector<char>{'b', 'c'}));
+  ASSERT_TRUE(ring->pop(msg));
+  EXPECT_EQ(msg, vector<char>{'d'});
+}
+
 TEST(Serializer, readPoolFromFile){
   vector<PAs> pps;
 
@@ -608,6 +826,135 @@ TEST(MapGen, testMapCoverMtype2){
 
 }
 
+TEST(MapGen, scanlineSpans){
+  // The spans need to cover exactly the cells of the PolygonIterator
+  Position start;
+  mt19937 generator(42);
+  uniform_real_distribution<double> coord(-6, 6);
+  vector<Span> spans;
+  for(int type : {1, 2}){
+    shared_ptr<GridMap> map = mapgen::generateMapType(11, 11, 0.1, 0.3, type, start);
+    for(int i=0; i<200; i++){
+      grid_map::Polygon poly;
+      poly.addVertex(Position(coord(generator), coord(generator)));
+      poly.addVertex(Position(coord(generator), coord(generator)));
+      poly.thickenLine(0.3);
+
+      set<pair<int, int>> expected, actual;
+      for(grid_map::PolygonIterator it(*map, poly); !it.isPastEnd(); ++it)
+	expected.insert({(*it)(0), (*it)(1)});
+      ASSERT_TRUE(polygonSpans(*map, poly, spans));
+      for(auto &span : spans)
+	for(int row = span.first; row <= span.last; row++)
+	  actual.insert({row, span.col});
+      EXPECT_EQ(expected, actual);
+    }
+  }
+}
+
+TEST(MapGen, packedLayers){
+  Position start;
+  shared_ptr<GridMap> map = mapgen::generateMapType(11, 11, 0.1, 0.3, 2, start);
+  mapgen::emulateCoveredMapSegment(map, start);
+  const Matrix &obstacle = (*map)["obstacle"];
+  const Matrix &covered = (*map)["covered"];
+  BitLayer obstacleBits(obstacle), coveredBits(covered);
+
+  mt19937 generator(42);
+  for(int i=0; i<500; i++){
+    int col = uniform_int_distribution<int>(0, obstacle.cols() - 1)(generator);
+    int first = uniform_int_distribution<int>(0, obstacle.rows() - 1)(generator);
+    int last = uniform_int_distribution<int>(first, obstacle.rows() - 1)(generator);
+    int expected = 0, expectedCovered = 0;
+    for(int row = first; row <= last; row++){
+      ASSERT_EQ(obstacleBits.test(row, col), obstacle(row, col) > 0);
+      expected += obstacle(row, col) > 0;
+      expectedCovered += covered(row, col) > 0 and !(obstacle(row, col) > 0);
+    }
+    EXPECT_EQ(obstacleBits.count(col, first, last), expected);
+    EXPECT_EQ(coveredBits.countExcept(obstacleBits, col, first, last), expectedCovered);
+  }
+}
+
+TEST(MapGen, scanlineMapMove){
+  Position start;
+  shared_ptr<GridMap> map = mapgen::generateMapType(11, 11, 0.1, 0.3, 2, start);
+  PolyRobot rob({{RP::Width, 0.3}}, make_shared<GridMap>(*map), "map");
+  PolyRobot robScan({{RP::Width, 0.3}}, make_shared<GridMap>(*map), "map");
+  rob.scanline = false;
+  ASSERT_TRUE(robScan.scanline);
+  robScan.packLayers();
+
+  PAs actions;
+  actions.push_back(make_shared<StartAction>(StartAction(start)));
+  for(int i=0; i<20; i++){
+    actions.push_back(make_shared<AheadAction>(AheadAction(PAT::CAhead, {{PAP::Angle, 37*i}, {PAP::Distance, 2}})));
+  }
+  PAs actionsScan;
+  for(auto &pa : actions){
+    if(pa->type == PAT::Start)
+      actionsScan.push_back(make_shared<StartAction>(*dynamic_pointer_cast<StartAction>(pa)));
+    else
+      actionsScan.push_back(make_shared<AheadAction>(*dynamic_pointer_cast<AheadAction>(pa)));
+  }
+  rob.evaluateActions(actions);
+  robScan.evaluateActions(actionsScan);
+  rob.syncCoverage();
+  robScan.syncCoverage();
+
+  EXPECT_TRUE((*rob.pmap)["map"] == (*robScan.pmap)["map"]);
+  for(int i=0; i<actions.size(); i++){
+    EXPECT_EQ(actions[i]->c_config, actionsScan[i]->c_config);
+    EXPECT_EQ(actions[i]->wps, actionsScan[i]->wps);
+  }
+}
+
+TEST_F(RobotTest, coverageEpochs){
+  PAs actions;
+  actions.push_back(make_shared<StartAction>(StartAction(Position(2.5, 2.5))));
+  actions.push_back(make_shared<AheadAction>(AheadAction(PAT::CAhead, {{PAP::Angle, 0}, {PAP::Distance, 2}})));
+  rob->evaluateActions(actions);
+  rob->syncCoverage();
+  Matrix first = (*cmap)["map"];
+  ASSERT_GT(first.sum(), 0);
+
+  // Old epochs must not influence the next evaluation, also after wrap around
+  rob->incremental = false;
+  rob->coverEpoch = numeric_limits<uint16_t>::max() - 1;
+  for(int i=0; i<3; i++){
+    actions[1]->modified = true;
+    rob->evaluateActions(actions);
+    EXPECT_EQ(actions[1]->c_config[Counter::CrossCount], 0);
+    rob->syncCoverage();
+    EXPECT_TRUE((*cmap)["map"] == first);
+  }
+
+  // The signature reads only the touched cells, it equals a scan of the synchronized layer
+  rob->incremental = true;
+  actions[1]->mod_config[PAP::Distance] = 1;
+  actions[1]->modified = true;
+  rob->evaluateActions(actions);
+  genome_tools::genome gen;
+  gen.setPathSignature(*rob);
+  rob->syncCoverage();
+  genome_tools::PathSignature scan((*cmap)["map"]);
+  EXPECT_EQ(gen.signature->cells, scan.cells);
+  EXPECT_EQ(gen.signature->values, scan.values);
+}
+
+TEST(GenTools, fitnessOrder){
+  genome_tools::Genpool pool;
+  for(float fitness : {0.5, 0.1, 0.9, 0.3, 0.7})
+    pool.push_back(genome_tools::genome(fitness));
+
+  EXPECT_EQ(genome_tools::fitnessOrder(pool), vector<int>({1, 3, 0, 4, 2}));
+  EXPECT_EQ(genome_tools::topK(pool, 2), vector<int>({4, 2}));
+  EXPECT_EQ(genome_tools::bottomK(pool, 2), vector<int>({1, 3}));
+  EXPECT_EQ(genome_tools::topK(pool, 10).size(), pool.size());
+  // The pool keeps its order
+  EXPECT_EQ(pool[0].fitness, 0.5);
+}
+
 TEST(GenTools, testErase){
   Position start(42,42), end(42,42);
 